@@ -61,6 +61,7 @@ public:
             ( "export-volume",
               "Export also the 3d volume (mhd + raw) containing the VSD values,"
               " in addition to the VTK file." )
+            ( "compress", "Compress the exported 3d volume data (zraw)" )
             ( "export-point-sprites",
               "Export also the point sprite files containing the VSD values,"
               " in addition to the VTK file." )
@@ -252,6 +253,7 @@ public:
         output->SetOrigin( origin );
 
         VolumeWriter< float > writer( output, fivox::Vector2ui( ));
+        writer.setCompression( _vm.count( "compress" ));
 
         const fivox::Vector2ui frameRange( getFrameRange( _eventSource->getDt( )));
         size_t numDigits = std::to_string( frameRange.y( )).length();
@@ -284,15 +286,13 @@ public:
             }
 
             _eventSource->setFrame( i );
+            _eventSource->setNextFrame( i + 1 );
             source->Modified();
 
             if( _vm.count( "export-volume" ))
             {
-                const std::string& volumeName = filename + ".mhd";
-                writer->SetFileName( volumeName );
-                source->Modified();
-                writer->Update(); // Run pipeline to write volume
-                LBINFO << "Volume written as " << volumeName << std::endl;
+                // run pipeline and write the volume in the background
+                writer.write( filename + ".mhd" );
             }
 
             projectVSD( output, filename );
@@ -0,0 +1,256 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                          Jafet.VillafrancaDiaz@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Eyescale Software GmbH nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fivox/fivox.h>
+#include "../volumeWriter.h"
+
+#include <boost/program_options.hpp>
+#include <itkImageFileReader.h>
+#include <itkImageIOFactory.h>
+#include <lunchbox/term.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+typedef itk::ImageIOBase::Pointer ImageIOPtr;
+
+/**
+ * Merge volume bricks, e.g. generated by 'voxelize --processes', into one
+ * volume. The position of each brick is computed from its origin, and the
+ * output is assembled plane by plane along z, so only one plane of the output
+ * and of each brick is kept in memory.
+ */
+template< typename T >
+bool _merge( const std::vector< std::string >& inputs,
+             const std::string& output )
+{
+    typedef itk::Image< T, 3 > Image;
+    typedef itk::ImageFileReader< Image > Reader;
+
+    std::vector< typename Reader::Pointer > readers;
+    std::vector< typename Image::RegionType > bricks;
+    typename Image::PointType origin;
+    origin.Fill( std::numeric_limits< double >::max( ));
+    typename Image::SpacingType spacing;
+
+    for( const std::string& input : inputs )
+    {
+        typename Reader::Pointer reader = Reader::New();
+        reader->SetFileName( input );
+        reader->UpdateOutputInformation();
+        const Image* image = reader->GetOutput();
+        for( size_t i = 0; i < 3; ++i )
+            origin[i] = std::min( origin[i], image->GetOrigin()[i] );
+        if( readers.empty( ))
+            spacing = image->GetSpacing();
+        else if( image->GetSpacing() != spacing )
+        {
+            LBERROR << "Spacing of " << input << " does not match the one of "
+                    << inputs.front() << std::endl;
+            return false;
+        }
+        readers.push_back( reader );
+    }
+
+    // position of each brick in the merged volume
+    typename Image::IndexType end;
+    end.Fill( 0 );
+    for( const auto& reader : readers )
+    {
+        const Image* image = reader->GetOutput();
+        typename Image::RegionType brick =
+            image->GetLargestPossibleRegion();
+        for( size_t i = 0; i < 3; ++i )
+        {
+            brick.SetIndex( i, std::lround(( image->GetOrigin()[i] -
+                                             origin[i] ) / spacing[i] ));
+            end[i] = std::max( end[i], brick.GetIndex( i ) +
+                                       long( brick.GetSize( i )));
+        }
+        bricks.push_back( brick );
+    }
+
+    typename Image::IndexType index;
+    index.Fill( 0 );
+    typename Image::RegionType region;
+    region.SetIndex( index );
+    for( size_t i = 0; i < 3; ++i )
+        region.SetSize( i, end[i] );
+
+    const std::string& baseName = output.substr( 0, output.find_last_of( "." ));
+    const std::string& rawFile = baseName + ".raw";
+    const size_t slashPos = rawFile.find_last_of( "/" );
+    const std::string& rawName = slashPos == std::string::npos
+                               ? rawFile : rawFile.substr( slashPos + 1 );
+    if( !writeMetaImageHeader< T >( output, rawName, region, spacing, origin ))
+    {
+        LBERROR << "Cannot write volume header " << output << std::endl;
+        return false;
+    }
+
+    std::ofstream raw( rawFile.c_str(), std::ios::binary | std::ios::trunc );
+    if( !raw.is_open( ))
+    {
+        LBERROR << "Cannot open volume data file " << rawFile << std::endl;
+        return false;
+    }
+
+    const size_t width = region.GetSize( 0 );
+    const size_t height = region.GetSize( 1 );
+    std::vector< T > plane( width * height );
+    for( long z = 0; z < long( region.GetSize( 2 )); ++z )
+    {
+        std::fill( plane.begin(), plane.end(), T( 0 ));
+        for( size_t b = 0; b < bricks.size(); ++b )
+        {
+            const auto& brick = bricks[b];
+            if( z < brick.GetIndex( 2 ) ||
+                z >= brick.GetIndex( 2 ) + long( brick.GetSize( 2 )))
+            {
+                continue;
+            }
+
+            // read only the current plane of the brick
+            Image* image = readers[b]->GetOutput();
+            typename Image::RegionType brickPlane =
+                image->GetLargestPossibleRegion();
+            brickPlane.SetIndex( 2, brickPlane.GetIndex( 2 ) + z -
+                                    brick.GetIndex( 2 ));
+            brickPlane.SetSize( 2, 1 );
+            image->SetRequestedRegion( brickPlane );
+            readers[b]->Update();
+
+            // readers of bricks which can not be streamed, e.g. compressed
+            // ones, buffer the whole brick instead of the requested plane
+            const T* data = image->GetBufferPointer() +
+                            image->ComputeOffset( brickPlane.GetIndex( ));
+            const size_t rowSize = brick.GetSize( 0 );
+            const size_t rowStride = image->GetOffsetTable()[1];
+            for( size_t y = 0; y < brick.GetSize( 1 ); ++y )
+            {
+                std::copy( data + y * rowStride, data + y * rowStride + rowSize,
+                           plane.data() + ( brick.GetIndex( 1 ) + y ) * width +
+                           brick.GetIndex( 0 ));
+            }
+        }
+        raw.write( reinterpret_cast< const char* >( plane.data( )),
+                   plane.size() * sizeof( T ));
+    }
+
+    if( !raw.good( ))
+    {
+        LBERROR << "Error while writing volume data to " << rawFile
+                << std::endl;
+        return false;
+    }
+    LBINFO << "Merged " << inputs.size() << " bricks into " << output
+           << std::endl;
+    return true;
+}
+}
+
+int main( int argc, char* argv[] )
+{
+    po::options_description options( "Merge volume bricks into one volume",
+                                     lunchbox::term::getSize().first );
+    options.add_options()
+//! [MergeBricksParameters] @anchor MergeBricks
+        ( "help,h", "Show help message" )
+        ( "version,v", "Show program name and version" )
+        ( "input,i", po::value< std::vector< std::string >>()->multitoken(),
+          "Brick volume files (mhd) to merge" )
+        ( "output,o", po::value< std::string >()->default_value( "volume.mhd" ),
+          "Name of the merged volume file (mhd and raw)" );
+//! [MergeBricksParameters]
+
+    po::positional_options_description positional;
+    positional.add( "input", -1 );
+
+    po::variables_map vm;
+    po::store( po::command_line_parser( argc, argv ).options( options )
+                   .positional( positional ).run(), vm );
+    po::notify( vm );
+
+    if( vm.count( "help" ))
+    {
+        std::cout << options << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if( vm.count( "version" ))
+    {
+        std::cout << argv[0] << " version " << fivox::Version::getString()
+                  << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if( !vm.count( "input" ))
+    {
+        std::cerr << "No input bricks given" << std::endl << options
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto& inputs = vm["input"].as< std::vector< std::string >>();
+    const std::string& output = vm["output"].as< std::string >();
+
+    ImageIOPtr io = itk::ImageIOFactory::CreateImageIO(
+                        inputs.front().c_str(), itk::ImageIOFactory::ReadMode );
+    if( !io )
+    {
+        std::cerr << "Cannot read " << inputs.front() << std::endl;
+        return EXIT_FAILURE;
+    }
+    io->SetFileName( inputs.front( ));
+    io->ReadImageInformation();
+
+    bool success = false;
+    switch( io->GetComponentType( ))
+    {
+    case itk::ImageIOBase::UCHAR:
+        success = _merge< uint8_t >( inputs, output );
+        break;
+    case itk::ImageIOBase::USHORT:
+        success = _merge< uint16_t >( inputs, output );
+        break;
+    case itk::ImageIOBase::UINT:
+        success = _merge< uint32_t >( inputs, output );
+        break;
+    case itk::ImageIOBase::FLOAT:
+        success = _merge< float >( inputs, output );
+        break;
+    default:
+        std::cerr << "Unsupported data type "
+                  << io->GetComponentTypeAsString( io->GetComponentType( ))
+                  << std::endl;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
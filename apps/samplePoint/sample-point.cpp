@@ -103,6 +103,7 @@ public:
         for( uint32_t i = frameRange.x(); i < frameRange.y(); ++i )
         {
             eventSource->setFrame( i );
+            eventSource->setNextFrame( i + 1 );
             eventSource->load( 0, eventSource->getNumChunks( ));
             const float value = (*functor)( itkPoint,
                                             fivox::FloatVolume::SpacingType( ));
@@ -67,13 +67,17 @@ class Launcher(object): # pylint: disable=too-few-public-methods
             self._volume += '&inputMin={datarange[0]}&inputMax={datarange[1]}'
 
         self._volume = self._volume.format(**vars(self._args))
-        if args.verbose:
-            print(self._volume)
 
         hash_object = hashlib.md5(str(self._volume))
         self._outname += "_{0}.nrrd".format(hash_object.hexdigest()[:7])
         self._outname = os.path.abspath(self._outname)
 
+        # the cache does not change the volume, nor its file name
+        if args.cache:
+            self._volume += '&synapseCache={0}'.format(os.path.abspath(args.cache))
+        if args.verbose:
+            print(self._volume)
+
     def launch(self):
         """
         Launch livre or voxelize and/or paraview.
@@ -143,6 +147,8 @@ def main():
                         help="resolution in micrometer/voxel, default 16")
     parser.add_argument("--reference", metavar='<path to volume>', default="",
                         help="path to reference volume for size and resolution setup")
+    parser.add_argument("--cache", metavar='<directory>', default="",
+                        help="directory to cache the synapse positions for later runs")
     parser.add_argument("-v", "--verbose", action="store_true",
                         help="Print volume URI")
     args = parser.parse_args()
@@ -33,8 +33,14 @@
 #define FIVOX_VOLUMEWRITER_H
 
 #include <fivox/scaleFilter.h>
+#include <fivox/volumeSeries.h>
 
+#include <itkImageDuplicator.h>
 #include <itkImageFileWriter.h>
+#include <lunchbox/clock.h>
+
+#include <fstream>
+#include <future>
 
 typedef fivox::FloatVolume::Pointer VolumePtr;
 
@@ -47,7 +53,8 @@ namespace
  */
 template< typename T > class VolumeWriter
 {
-    typedef itk::ImageFileWriter< itk::Image< T, 3 >> Writer;
+    typedef itk::Image< T, 3 > Image;
+    typedef itk::ImageFileWriter< Image > Writer;
 
 public:
     /**
@@ -57,25 +64,442 @@ public:
     VolumeWriter( VolumePtr input, const vmml::Vector2f& dataRange )
         : _input( input )
         , _scaler( _input, dataRange )
-        , _writer( Writer::New( ))
+        , _compress( false )
+    {}
+
+    /**
+     * @param source image source generating the input volume
+     * @param dataRange range of the data to be used as reference to scale;
+     *                  for FULLDATARANGE, the range is computed from the
+     *                  statistics gathered by the source while sampling
+     * @param percentiles percentiles of the sampled values used as range for
+     *                    FULLDATARANGE
+     */
+    VolumeWriter( fivox::ImageSourcePtr< fivox::FloatVolume > source,
+                  const vmml::Vector2f& dataRange,
+                  const vmml::Vector2f& percentiles )
+        : _input( source->GetOutput( ))
+        , _scaler( source, dataRange, percentiles )
+        , _compress( false )
+    {}
+
+    /**
+     * @param source image source of the output type, e.g. from
+     *               fivox::URIHandler::newScaledImageSource(), whose volumes
+     *               are written without scaling
+     */
+    explicit VolumeWriter( fivox::ImageSourcePtr< Image > source )
+        : _volumeSource( source )
+        , _compress( false )
+    {}
+
+    ~VolumeWriter()
+    {
+        try
+        {
+            flush();
+        }
+        catch( const std::exception& e )
+        {
+            LBERROR << "Error while writing volume: " << e.what() << std::endl;
+        }
+    }
+
+    /**
+     * Enable or disable the compression of the written volume data. MetaImage
+     * volumes are compressed with zlib into a .zraw data file.
+     */
+    void setCompression( const bool compress )
+    {
+        _compress = compress;
+    }
+
+    /**
+     * Run the pipeline and write the resulting volume in the background.
+     *
+     * The pipeline generates the volume while the previous one is still being
+     * written. Once that write is finished, the volume is copied and written
+     * by a separate thread, so the pipeline output keeps its region, spacing
+     * and origin for the next volume.
+     *
+     * @param filename name of the volume file to write
+     */
+    void write( const std::string& filename )
     {
-        _writer->SetInput( _scaler.GetOutput( ));
+        const typename Image::Pointer output = _update();
+        flush();
+
+        typedef itk::ImageDuplicator< Image > Duplicator;
+        typename Duplicator::Pointer duplicator = Duplicator::New();
+        duplicator->SetInputImage( output );
+        duplicator->Update();
+        const typename Image::Pointer volume = duplicator->GetOutput();
+
+        const bool compress = _compress;
+        _pending = std::async( std::launch::async,
+                               [volume, filename, compress]
+                               { _write( volume, filename, compress ); });
     }
 
-    typename Writer::Pointer operator->() { return _writer; }
+    /** Wait for the pending write, rethrowing its errors if any. */
+    void flush()
+    {
+        if( _pending.valid( ))
+            _pending.get();
+    }
 
 private:
+    typename Image::Pointer _update()
+    {
+        if( _volumeSource )
+        {
+            _volumeSource->Update();
+            return _volumeSource->GetOutput();
+        }
+        _scaler.Update();
+        return _scaler.GetOutput();
+    }
+
+    static void _write( typename Image::Pointer volume,
+                        const std::string& filename, const bool compress )
+    {
+        typename Writer::Pointer writer = Writer::New();
+        writer->SetInput( volume );
+        writer->SetFileName( filename );
+        writer->SetUseCompression( compress );
+
+        lunchbox::Clock clock;
+        writer->Update();
+        const float time = clock.getTimef() / 1000.f;
+
+        const size_t size = volume->GetBufferedRegion().GetNumberOfPixels() *
+                            sizeof( T );
+        const size_t fileSize = _getFileSize( _getDataFile( filename,
+                                                            compress ));
+        LBINFO << "Volume written as " << filename << " ("
+               << ( fileSize > 0 ? float( size ) / float( fileSize ) : 0.f )
+               << ":1 compression, "
+               << float( size ) / ( 1024.f * 1024.f ) / std::max( time, 1e-6f )
+               << " MB/s)" << std::endl;
+    }
+
+    static std::string _getDataFile( const std::string& filename,
+                                     const bool compress )
+    {
+        const size_t dotPos = filename.find_last_of( "." );
+        if( dotPos == std::string::npos || filename.substr( dotPos ) != ".mhd" )
+            return filename;
+        return filename.substr( 0, dotPos ) + ( compress ? ".zraw" : ".raw" );
+    }
+
+    static size_t _getFileSize( const std::string& filename )
+    {
+        std::ifstream file( filename.c_str(), std::ios::binary | std::ios::ate );
+        return file.is_open() ? size_t( file.tellg( )) : 0;
+    }
+
     VolumePtr _input;
-    fivox::ScaleFilter< itk::Image< T, 3 >> _scaler;
-    typename Writer::Pointer _writer;
+    fivox::ScaleFilter< Image > _scaler;
+    fivox::ImageSourcePtr< Image > _volumeSource;
+    fivox::ImageSourcePtr< fivox::FloatVolume > _source;
+    bool _compress;
+    std::future< void > _pending;
 };
 
 template<> VolumeWriter< float >::VolumeWriter( VolumePtr input,
                                                 const vmml::Vector2f& )
     : _input( input )
-    , _writer( Writer::New( ))
+    , _compress( false )
+{}
+
+template<> VolumeWriter< float >::VolumeWriter(
+        fivox::ImageSourcePtr< fivox::FloatVolume > source,
+        const vmml::Vector2f&, const vmml::Vector2f& )
+    : _input( source->GetOutput( ))
+    , _source( source )
+    , _compress( false )
+{}
+
+template<> fivox::FloatVolume::Pointer VolumeWriter< float >::_update()
+{
+    if( _volumeSource )
+    {
+        _volumeSource->Update();
+        return _volumeSource->GetOutput();
+    }
+    if( _source )
+    {
+        _source->Update();
+        return _source->GetOutput();
+    }
+    _input->Update();
+    return _input;
+}
+
+template< typename T > const char* _getMetaElementType();
+template<> const char* _getMetaElementType< uint8_t >() { return "MET_UCHAR"; }
+template<> const char* _getMetaElementType< uint16_t >() { return "MET_USHORT"; }
+template<> const char* _getMetaElementType< uint32_t >() { return "MET_UINT"; }
+template<> const char* _getMetaElementType< float >() { return "MET_FLOAT"; }
+
+/**
+ * Write the MetaImage header (mhd) of a volume whose voxels are stored in the
+ * given raw file.
+ *
+ * @param filename name of the mhd file to write
+ * @param rawFilename name of the raw data file, relative to the mhd file
+ * @param region region of the volume, its index defines the origin offset
+ * @param spacing the volume spacing
+ * @param origin the origin of the volume at index 0
+ * @return true if the header was written successfully
+ */
+template< typename T >
+bool writeMetaImageHeader( const std::string& filename,
+                           const std::string& rawFilename,
+                           const fivox::FloatVolume::RegionType& region,
+                           const fivox::FloatVolume::SpacingType& spacing,
+                           const fivox::FloatVolume::PointType& origin )
+{
+    std::ofstream file( filename.c_str( ));
+    if( !file.is_open( ))
+        return false;
+
+    const auto& index = region.GetIndex();
+    const auto& size = region.GetSize();
+    file << "ObjectType = Image\n"
+         << "NDims = 3\n"
+         << "BinaryData = True\n"
+         << "BinaryDataByteOrderMSB = False\n"
+         << "CompressedData = False\n"
+         << "TransformMatrix = 1 0 0 0 1 0 0 0 1\n"
+         << "Offset = " << origin[0] + index[0] * spacing[0] << " "
+                        << origin[1] + index[1] * spacing[1] << " "
+                        << origin[2] + index[2] * spacing[2] << "\n"
+         << "CenterOfRotation = 0 0 0\n"
+         << "AnatomicalOrientation = RAI\n"
+         << "ElementSpacing = " << spacing[0] << " " << spacing[1] << " "
+                                << spacing[2] << "\n"
+         << "DimSize = " << size[0] << " " << size[1] << " " << size[2] << "\n"
+         << "ElementType = " << _getMetaElementType< T >() << "\n"
+         << "ElementDataFile = " << rawFilename << std::endl;
+    return file.good();
+}
+
+/**
+ * Writes a volume slab by slab into a MetaImage (mhd + raw) file. Each slab
+ * covers complete xy-planes, so slabs generated in increasing z order are
+ * appended to the raw file and only one slab needs to be kept in memory.
+ */
+template< typename T > class SlabWriter
+{
+    typedef itk::Image< T, 3 > Image;
+
+public:
+    /**
+     * @param input pointer to the input volume, its requested region defines
+     *              the slab to generate
+     * @param dataRange range of the data to be used as reference to scale
+     */
+    SlabWriter( VolumePtr input, const vmml::Vector2f& dataRange )
+        : _input( input )
+        , _scaler( _input, dataRange )
+    {}
+
+    /**
+     * Start a new volume file.
+     *
+     * @param filename the name of the mhd file; the raw file is named after it
+     * @param region the region of the full volume
+     * @throw std::runtime_error if the files cannot be opened
+     */
+    void open( const std::string& filename,
+               const fivox::FloatVolume::RegionType& region )
+    {
+        const std::string& baseName = filename.substr( 0,
+                                                   filename.find_last_of( "." ));
+        const std::string& rawFile = baseName + ".raw";
+        const size_t slashPos = rawFile.find_last_of( "/" );
+        const std::string& rawName = slashPos == std::string::npos
+                                   ? rawFile : rawFile.substr( slashPos + 1 );
+
+        if( !writeMetaImageHeader< T >( filename, rawName, region,
+                                        _input->GetSpacing(),
+                                        _input->GetOrigin( )))
+        {
+            LBTHROW( std::runtime_error( "Cannot write volume header " +
+                                         filename ));
+        }
+
+        _raw.close();
+        _raw.open( rawFile.c_str(), std::ios::binary | std::ios::trunc );
+        if( !_raw.is_open( ))
+            LBTHROW( std::runtime_error( "Cannot open volume data file " +
+                                         rawFile ));
+    }
+
+    /** Generate the current slab of the input and append it to the file. */
+    void write()
+    {
+        const typename Image::Pointer slab = _update();
+        const size_t numVoxels =
+            slab->GetBufferedRegion().GetNumberOfPixels();
+        _raw.write( reinterpret_cast< const char* >( slab->GetBufferPointer( )),
+                    numVoxels * sizeof( T ));
+        if( !_raw.good( ))
+            LBTHROW( std::runtime_error( "Error while writing volume data" ));
+    }
+
+    /** Finish writing the current volume file. */
+    void close()
+    {
+        _raw.close();
+    }
+
+private:
+    typename Image::Pointer _update()
+    {
+        _scaler.Update();
+        return _scaler.GetOutput();
+    }
+
+    VolumePtr _input;
+    fivox::ScaleFilter< Image > _scaler;
+    std::ofstream _raw;
+};
+
+template<> SlabWriter< float >::SlabWriter( VolumePtr input,
+                                            const vmml::Vector2f& )
+    : _input( input )
+{}
+
+template<> fivox::FloatVolume::Pointer SlabWriter< float >::_update()
+{
+    _input->Update();
+    return _input;
+}
+
+/**
+ * Writes the frames of a volume time series into one file, either chunked
+ * (see fivox::VolumeSeriesWriter) or delta encoded (see
+ * fivox::DeltaVolumeSeriesWriter).
+ */
+template< typename T > class SeriesWriter
+{
+    typedef itk::Image< T, 3 > Image;
+
+public:
+    /**
+     * @param input pointer to the input volume
+     * @param dataRange range of the data to be used as reference to scale
+     */
+    SeriesWriter( VolumePtr input, const vmml::Vector2f& dataRange )
+        : _input( input )
+        , _scaler( _input, dataRange )
+    {}
+
+    /**
+     * Create the series file for the current region of the input volume.
+     *
+     * @param filename the name of the series file
+     * @param numFrames the number of frames of the series
+     * @param chunkSize the number of voxels of a chunk in each dimension
+     * @throw std::runtime_error if the file cannot be created
+     */
+    void open( const std::string& filename, const size_t numFrames,
+               const size_t chunkSize )
+    {
+        const auto& region = _input->GetLargestPossibleRegion();
+        const auto& spacing = _input->GetSpacing();
+        const fivox::Vector3ui size( region.GetSize( 0 ), region.GetSize( 1 ),
+                                     region.GetSize( 2 ));
+
+        _series.reset( new fivox::VolumeSeriesWriter(
+                           filename, size, numFrames,
+                           fivox::Vector3ui( chunkSize ),
+                           fivox::getVolumeDataType< T >( )));
+        _series->setSpacing( fivox::Vector3f( spacing[0], spacing[1],
+                                              spacing[2] ));
+        _series->setOrigin( _getOrigin( ));
+    }
+
+    /**
+     * Create a delta encoded series file for the current region of the input
+     * volume.
+     *
+     * @param filename the name of the series file
+     * @param keyframeInterval the number of frames between two keyframes
+     * @throw std::runtime_error if the file cannot be created
+     */
+    void openDelta( const std::string& filename, const size_t keyframeInterval )
+    {
+        const auto& region = _input->GetLargestPossibleRegion();
+        const auto& spacing = _input->GetSpacing();
+        const fivox::Vector3ui size( region.GetSize( 0 ), region.GetSize( 1 ),
+                                     region.GetSize( 2 ));
+
+        _deltaSeries.reset( new fivox::DeltaVolumeSeriesWriter(
+                                filename, size, keyframeInterval,
+                                fivox::getVolumeDataType< T >( )));
+        _deltaSeries->setSpacing( fivox::Vector3f( spacing[0], spacing[1],
+                                                   spacing[2] ));
+        _deltaSeries->setOrigin( _getOrigin( ));
+    }
+
+    /**
+     * Run the pipeline and write its volume as the given frame of the series.
+     *
+     * @param frame the frame index, relative to the start of the series
+     */
+    void write( const size_t frame )
+    {
+        const T* data = _update()->GetBufferPointer();
+        if( _deltaSeries )
+            _deltaSeries->writeFrame( data );
+        else
+            _series->writeFrame( frame, data );
+    }
+
+    /** Finish writing the series file. */
+    void close()
+    {
+        if( _deltaSeries )
+            _deltaSeries->close();
+        _deltaSeries.reset();
+        _series.reset();
+    }
+
+private:
+    fivox::Vector3f _getOrigin() const
+    {
+        const auto& region = _input->GetLargestPossibleRegion();
+        const auto& spacing = _input->GetSpacing();
+        const auto& origin = _input->GetOrigin();
+        return fivox::Vector3f( origin[0] + region.GetIndex( 0 ) * spacing[0],
+                                origin[1] + region.GetIndex( 1 ) * spacing[1],
+                                origin[2] + region.GetIndex( 2 ) * spacing[2] );
+    }
+
+    typename Image::Pointer _update()
+    {
+        _scaler.Update();
+        return _scaler.GetOutput();
+    }
+
+    VolumePtr _input;
+    fivox::ScaleFilter< Image > _scaler;
+    std::unique_ptr< fivox::VolumeSeriesWriter > _series;
+    std::unique_ptr< fivox::DeltaVolumeSeriesWriter > _deltaSeries;
+};
+
+template<> SeriesWriter< float >::SeriesWriter( VolumePtr input,
+                                                const vmml::Vector2f& )
+    : _input( input )
+{}
+
+template<> fivox::FloatVolume::Pointer SeriesWriter< float >::_update()
 {
-    _writer->SetInput( _input );
+    _input->Update();
+    return _input;
 }
 }
 #endif
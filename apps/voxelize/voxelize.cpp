@@ -34,9 +34,25 @@
 #include "../commandLineApplication.h"
 #include "../volumeWriter.h"
 
+#include <cstring>
+#include <sys/wait.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
 namespace
 {
 
+/** Settings of the output files, given by the command line options */
+struct OutputOptions
+{
+    std::string format;      //!< mhd, series or delta
+    size_t maxMemory;        //!< memory budget in bytes for one volume, 0 if none
+    bool compress;           //!< compress the volume data
+    size_t chunkSize;        //!< voxels per chunk dimension of series files
+    size_t keyframeInterval; //!< frames between keyframes of delta files
+};
+
 void _getNameAndExtension( const std::string& filePath,
                            std::string& outputName, std::string& extension )
 {
@@ -57,35 +73,223 @@ void _getNameAndExtension( const std::string& filePath,
     }
 }
 
+std::string _getVolumeName( const std::string& outputName,
+                            const std::string& extension,
+                            const vmml::Vector2ui& frameRange,
+                            const uint32_t frame )
+{
+    if( frameRange.y() - frameRange.x() <= 1 )
+        return outputName + extension;
+
+    const size_t numDigits = std::to_string( frameRange.y( )).length();
+    std::ostringstream os;
+    os << outputName << std::setfill('0') << std::setw(numDigits)
+       << frame << extension;
+    return os.str();
+}
+
+/**
+ * @return an image source sampling directly into T and sharing the events of
+ *         the given source, or nullptr if not supported for T and the URI
+ */
+template< typename T > fivox::ImageSourcePtr< itk::Image< T, 3 >>
+_newScaledSource( ImageSourcePtr, const fivox::URIHandler& )
+{
+    return nullptr;
+}
+
+template< typename TImage > fivox::ImageSourcePtr< TImage >
+_setupScaledSource( ImageSourcePtr source, const fivox::URIHandler& params )
+{
+    auto scaledSource =
+        params.newScaledImageSource< TImage >( source->getEventSource( ));
+    if( !scaledSource )
+        return nullptr;
+
+    const VolumePtr input = source->GetOutput();
+    auto output = scaledSource->GetOutput();
+    output->SetRegions( input->GetLargestPossibleRegion( ));
+    output->SetSpacing( input->GetSpacing( ));
+    output->SetOrigin( input->GetOrigin( ));
+    return scaledSource;
+}
+
+template<> fivox::ImageSourcePtr< fivox::ByteVolume >
+_newScaledSource< uint8_t >( ImageSourcePtr source,
+                             const fivox::URIHandler& params )
+{
+    return _setupScaledSource< fivox::ByteVolume >( source, params );
+}
+
+template<> fivox::ImageSourcePtr< fivox::ShortVolume >
+_newScaledSource< uint16_t >( ImageSourcePtr source,
+                              const fivox::URIHandler& params )
+{
+    return _setupScaledSource< fivox::ShortVolume >( source, params );
+}
+
 template< typename T >
-void _sample( ImageSourcePtr source, const vmml::Vector2ui& frameRange,
-              const fivox::URIHandler& params, const std::string& filePath )
+void _sampleVolumes( ImageSourcePtr source, const vmml::Vector2ui& frameRange,
+                     const fivox::URIHandler& params,
+                     const std::string& filePath, const bool compress )
+{
+    // sample directly into the output type if possible, which saves the
+    // intermediate float volume and the scaling pass over it
+    const auto scaledSource = _newScaledSource< T >( source, params );
+    std::unique_ptr< VolumeWriter< T >> writerPtr( scaledSource ?
+        new VolumeWriter< T >( scaledSource ) :
+        new VolumeWriter< T >( source, params.getInputRange(),
+                               params.getInputPercentiles( )));
+    VolumeWriter< T >& writer = *writerPtr;
+    writer.setCompression( compress );
+
+    std::string outputName, extension;
+    _getNameAndExtension( filePath, outputName, extension );
+
+    for( uint32_t i = frameRange.x(); i < frameRange.y(); ++i )
+    {
+        source->getEventSource()->setFrame( i );
+        source->getEventSource()->setNextFrame( i + 1 );
+        source->Modified();
+        if( scaledSource )
+            scaledSource->Modified();
+
+        // run pipeline and write the volume while sampling the next frame
+        writer.write( _getVolumeName( outputName, extension, frameRange, i ));
+    }
+    writer.flush();
+}
+
+/**
+ * Sample the volume in slabs of complete xy-planes, each of them small enough
+ * to fit in the given memory budget, and append them to the output file.
+ */
+template< typename T >
+void _sampleSlabs( ImageSourcePtr source, const vmml::Vector2ui& frameRange,
+                   const fivox::URIHandler& params, const std::string& filePath,
+                   const size_t maxMemory )
 {
+    if( !std::is_same< T, float >::value &&
+        params.getInputRange() == fivox::FULLDATARANGE )
+    {
+        LBTHROW( std::runtime_error( "Slab-wise sampling of integer volumes "
+                                     "needs an explicit inputMin/inputMax" ));
+    }
+
     VolumePtr input = source->GetOutput();
-    VolumeWriter< T > writer( input, params.getInputRange( ));
+    const fivox::FloatVolume::RegionType region =
+        input->GetLargestPossibleRegion();
+    const fivox::FloatVolume::SizeType& size = region.GetSize();
+
+    // the float volume of the slab, plus its scaled copy for integer types
+    const size_t voxelSize = sizeof( float ) +
+                             ( std::is_same< T, float >::value ? 0 : sizeof(T));
+    const size_t planeSize = size[0] * size[1] * voxelSize;
+    const size_t slabDepth = std::max( size_t( 1 ), maxMemory / planeSize );
+    if( maxMemory < planeSize )
+        LBWARN << "Memory budget of " << maxMemory << " bytes is smaller "
+               << "than one volume plane of " << planeSize << " bytes"
+               << std::endl;
+
+    const size_t numSlabs = ( size[2] + slabDepth - 1 ) / slabDepth;
+    LBINFO << "Sampling " << numSlabs << " slab(s) of up to " << slabDepth
+           << " plane(s) per volume" << std::endl;
+
+    SlabWriter< T > writer( input, params.getInputRange( ));
 
     std::string outputName, extension;
     _getNameAndExtension( filePath, outputName, extension );
 
-    const size_t numDigits = std::to_string( frameRange.y( )).length();
     for( uint32_t i = frameRange.x(); i < frameRange.y(); ++i )
     {
         source->getEventSource()->setFrame( i );
+        source->getEventSource()->setNextFrame( i + 1 );
 
-        std::string volumeName = outputName + extension;
-        if( frameRange.y() - frameRange.x() > 1 )
+        const std::string& volumeName =
+            _getVolumeName( outputName, ".mhd", frameRange, i );
+        writer.open( volumeName, region );
+
+        for( size_t z = 0; z < size[2]; z += slabDepth )
         {
-            std::ostringstream os;
-            os << outputName << std::setfill('0') << std::setw(numDigits)
-               << i << extension;
-            volumeName = os.str();
+            fivox::FloatVolume::RegionType slab = region;
+            slab.SetIndex( 2, region.GetIndex( 2 ) + z );
+            slab.SetSize( 2, std::min( slabDepth, size[2] - z ));
+
+            input->SetRegions( slab );
+            source->Modified();
+            writer.write();
         }
+        writer.close();
+        input->SetRegions( region );
+        LBINFO << "Volume written as " << volumeName << std::endl;
+    }
+}
 
-        writer->SetFileName( volumeName );
+/** Sample all frames into one chunked or delta encoded volume series file. */
+template< typename T >
+void _sampleSeries( ImageSourcePtr source, const vmml::Vector2ui& frameRange,
+                    const fivox::URIHandler& params,
+                    const std::string& filePath, const OutputOptions& options )
+{
+    std::string outputName, extension;
+    _getNameAndExtension( filePath, outputName, extension );
+
+    SeriesWriter< T > writer( source->GetOutput(), params.getInputRange( ));
+    std::string seriesName;
+    if( options.format == "delta" )
+    {
+        seriesName = outputName + ".fvd";
+        writer.openDelta( seriesName, options.keyframeInterval );
+    }
+    else
+    {
+        seriesName = outputName + ".fvs";
+        writer.open( seriesName, frameRange.y() - frameRange.x(),
+                     options.chunkSize );
+    }
+
+    for( uint32_t i = frameRange.x(); i < frameRange.y(); ++i )
+    {
+        source->getEventSource()->setFrame( i );
+        source->getEventSource()->setNextFrame( i + 1 );
         source->Modified();
-        writer->Update(); // Run pipeline to write volume
-        LBINFO << "Volume written as " << volumeName << std::endl;
+        writer.write( i - frameRange.x( ));
+        LBINFO << "Frame " << i << " written to " << seriesName << std::endl;
     }
+    writer.close();
+}
+
+template< typename T >
+void _sample( ImageSourcePtr source, const vmml::Vector2ui& frameRange,
+              const fivox::URIHandler& params, const std::string& filePath,
+              const OutputOptions& options )
+{
+    if( options.format == "series" || options.format == "delta" )
+    {
+        if( options.maxMemory > 0 || options.compress )
+            LBWARN << "Volume series are written uncompressed and sampled "
+                   << "in one piece, ignoring --max-memory and --compress"
+                   << std::endl;
+        _sampleSeries< T >( source, frameRange, params, filePath, options );
+        return;
+    }
+
+    const fivox::FloatVolume::RegionType& region =
+        source->GetOutput()->GetLargestPossibleRegion();
+    const size_t volumeSize = region.GetNumberOfPixels() * sizeof( float );
+
+    if( options.maxMemory == 0 || volumeSize <= options.maxMemory )
+    {
+        _sampleVolumes< T >( source, frameRange, params, filePath,
+                             options.compress );
+        return;
+    }
+
+    if( options.compress )
+        LBWARN << "Volumes sampled in slabs are written uncompressed"
+               << std::endl;
+    _sampleSlabs< T >( source, frameRange, params, filePath,
+                       options.maxMemory );
 }
 }
 
@@ -112,7 +316,25 @@ public:
             ( "decompose", po::value< fivox::Vector2ui >(),
               "'rank size' data-decomposition for parallel job submission" )
             ( "export-events", po::value< std::string >(),
-              "Name of the output events file (binary format)" );
+              "Name of the output events file (binary format)" )
+            ( "compress", "Compress the volume data (zraw) while sampling the "
+              "next frame" )
+            ( "output-format",
+              po::value< std::string >()->default_value( "mhd" ),
+              "Format of the output: one volume file (mhd and raw) per frame "
+              "[mhd (default)], one chunked file (fvs) with all frames "
+              "[series], or one file (fvd) with keyframes and lossless deltas "
+              "between consecutive frames [delta]" )
+            ( "chunk-size", po::value< size_t >()->default_value( 64 ),
+              "Number of voxels per dimension of the chunks of a series" )
+            ( "keyframe-interval", po::value< size_t >()->default_value( 10 ),
+              "Number of frames between two keyframes of a delta series" )
+            ( "max-memory", po::value< size_t >(),
+              "Memory budget in MB for the sampled volume; larger volumes are "
+              "sampled in slabs which are written one after the other" )
+            ( "processes,p", po::value< size_t >(),
+              "Number of local worker processes, each sampling one brick of a "
+              "3D decomposition of the volume" );
 //! [VoxelizeParameters]
     }
 
@@ -166,30 +388,143 @@ public:
             loader->write( _vm["export-events"].as< std::string >(),
                            fivox::EventFileFormat::binary );
 
+        if( _vm.count( "processes" ) && _vm["processes"].as< size_t >() > 1 )
+            _sampleBricks( source, frameRange, params, volumeHandler );
+        else
+            _sampleDatatype( source, frameRange, params, _outputFile );
+    }
+
+private:
+    void _sampleDatatype( ImageSourcePtr source,
+                          const fivox::Vector2ui& frameRange,
+                          const ::fivox::URIHandler& params,
+                          const std::string& outputFile )
+    {
+        OutputOptions options;
+        options.format = _vm["output-format"].as< std::string >();
+        options.maxMemory = _vm.count( "max-memory" ) ?
+                    _vm["max-memory"].as< size_t >() * 1024 * 1024 : 0;
+        options.compress = _vm.count( "compress" );
+        options.chunkSize = _vm["chunk-size"].as< size_t >();
+        options.keyframeInterval = _vm["keyframe-interval"].as< size_t >();
+
         const std::string& datatype( _vm["datatype"].as< std::string >( ));
         if( datatype == "char" )
         {
             LBINFO << "Sampling volume as char (uint8_t) data" << std::endl;
-            _sample< uint8_t >( source, frameRange, params, _outputFile );
+            _sample< uint8_t >( source, frameRange, params, outputFile,
+                                options );
         }
         else if( datatype == "short" )
         {
             LBINFO << "Sampling volume as short (uint16_t) data" << std::endl;
-            _sample< uint16_t >( source, frameRange, params, _outputFile );
+            _sample< uint16_t >( source, frameRange, params, outputFile,
+                                 options );
         }
         else if( datatype == "int" )
         {
             LBINFO << "Sampling volume as int (uint32_t) data" << std::endl;
-            _sample< uint32_t >( source, frameRange, params, _outputFile );
+            _sample< uint32_t >( source, frameRange, params, outputFile,
+                                 options );
         }
         else
         {
             LBINFO << "Sampling volume as floating point data" << std::endl;
-            _sample< float >( source, frameRange, params, _outputFile );
+            _sample< float >( source, frameRange, params, outputFile,
+                              options );
         }
     }
 
-private:
+    /**
+     * Sample the volume in a 3D brick decomposition, using one forked worker
+     * process per brick. The workers share the already loaded events with the
+     * parent process, and write one volume per brick and frame.
+     */
+    void _sampleBricks( ImageSourcePtr source,
+                        const fivox::Vector2ui& frameRange,
+                        const ::fivox::URIHandler& params,
+                        const fivox::VolumeHandler& volumeHandler )
+    {
+        if( _decompose[1] > 1 )
+            LBTHROW( std::runtime_error( "--processes can not be combined "
+                                         "with --decompose" ));
+
+        if( _vm["datatype"].as< std::string >() != "float" &&
+            params.getInputRange() == fivox::FULLDATARANGE )
+        {
+            LBWARN << "Bricks are scaled independently from their own data "
+                   << "range; use inputMin/inputMax for consistent values"
+                   << std::endl;
+        }
+
+        const size_t numProcesses = _vm["processes"].as< size_t >();
+        const fivox::Vector3ui& layout =
+            volumeHandler.computeBrickLayout( numProcesses );
+        LBINFO << "Sampling volume in " << layout << " bricks using "
+               << numProcesses << " processes" << std::endl;
+
+        const size_t numThreads =
+            std::max( 1u, std::thread::hardware_concurrency() /
+                          unsigned( numProcesses ));
+
+        std::vector< pid_t > workers;
+        for( size_t k = 0; k < layout[2]; ++k )
+        for( size_t j = 0; j < layout[1]; ++j )
+        for( size_t i = 0; i < layout[0]; ++i )
+        {
+            const fivox::Vector3ui brick( i, j, k );
+            std::ostringstream os;
+            os << _outputFile << "_" << i << "_" << j << "_" << k;
+
+            const pid_t pid = fork();
+            if( pid < 0 )
+            {
+                LBERROR << "Cannot fork worker for brick " << brick << ": "
+                        << strerror( errno ) << std::endl;
+                continue;
+            }
+            if( pid > 0 )
+            {
+                workers.push_back( pid );
+                continue;
+            }
+
+            // worker process
+            int result = EXIT_SUCCESS;
+            try
+            {
+                source->GetOutput()->SetRegions(
+                    volumeHandler.computeBrick( brick, layout ));
+                source->SetNumberOfThreads( numThreads );
+                _sampleDatatype( source, frameRange, params, os.str( ));
+            }
+            catch( const std::exception& e )
+            {
+                LBERROR << "Brick " << brick << " failed: " << e.what()
+                        << std::endl;
+                result = EXIT_FAILURE;
+            }
+            _exit( result );
+        }
+
+        size_t numFailed = numProcesses - workers.size();
+        for( const pid_t pid : workers )
+        {
+            int status = 0;
+            if( waitpid( pid, &status, 0 ) < 0 || !WIFEXITED( status ) ||
+                WEXITSTATUS( status ) != EXIT_SUCCESS )
+            {
+                ++numFailed;
+            }
+        }
+
+        if( numFailed > 0 )
+            LBTHROW( std::runtime_error( std::to_string( numFailed ) +
+                                         " brick(s) failed to sample" ));
+        LBINFO << "Sampled " << numProcesses << " bricks, use merge-bricks "
+               << "to assemble them into one volume" << std::endl;
+    }
+
     std::string _outputFile;
     ::fivox::Vector2ui _decompose;
 };
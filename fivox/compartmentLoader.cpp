@@ -45,18 +45,14 @@ public:
         : _output( output )
         , _report( params.getConfig().getReportSource( params.getReport( )),
                    brion::MODE_READ, params.getGIDs( ))
+        , _frameLoader( _report )
     {
-        const brain::Circuit circuit( params.getConfig( ));
-        const auto morphologies = circuit.loadMorphologies(
-            params.getGIDs(), brain::Circuit::Coordinates::global );
-
-        helpers::addCompartmentEvents( morphologies, _report, output );
+        helpers::loadCompartmentEvents( params, _report, output );
     }
 
     ssize_t load()
     {
-        const brion::floatsPtr values =
-                _report.loadFrame( _output.getCurrentTime( ));
+        const brion::floatsPtr values = _frameLoader.load( _output );
         if( !values )
             return -1;
 
@@ -68,6 +64,7 @@ public:
 
     EventSource& _output;
     brion::CompartmentReport _report;
+    helpers::FrameLoader _frameLoader;
 };
 
 CompartmentLoader::CompartmentLoader( const URIHandler& params )
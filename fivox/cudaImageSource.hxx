@@ -106,6 +106,8 @@ void CudaImageSource< TImage >::GenerateData()
     gpuErrchk( cudaFree( values ));
     gpuErrchk( cudaFree( cudaOutput ));
 
+    VolumeStatistics& statistics = Superclass::_statistics;
+    statistics.reset( Superclass::_histogramEnabled );
     for( size_t i = 0; i < width; ++i )
         for( size_t j = 0; j < height; ++j )
             for( size_t k = 0; k < depth; ++k )
@@ -115,6 +117,7 @@ void CudaImageSource< TImage >::GenerateData()
                 index[1] = j;
                 index[2] = k;
                 const size_t flatIndex = i + j * width + k * width * height;
+                statistics.add( output[flatIndex] );
                 image->SetPixel( index, output[flatIndex] );
             }
     free( output );
@@ -28,7 +28,12 @@
 #include <lunchbox/log.h>
 #include <lunchbox/memoryMap.h>
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <list>
+#include <unordered_map>
 
 #ifdef USE_BOOST_GEOMETRY
 #  include <lunchbox/lock.h>
@@ -46,13 +51,15 @@ typedef bg::model::box< Point > Box;
 typedef std::pair< Point, size_t > Value;
 typedef std::vector< Value > Values;
 
+const size_t maxElemInNode = 64;
+const size_t minElemInNode = 16;
+typedef bgi::rtree< Value, bgi::rstar< maxElemInNode, minElemInNode >> RTree;
+
 #endif
 
 namespace
 {
 
-const size_t maxElemInNode = 64;
-const size_t minElemInNode = 16;
 const uint32_t magic = 0xfebf;
 const uint32_t version = 1;
 
@@ -62,6 +69,19 @@ size_t _getBinarySize( const size_t numEvents )
            sizeof( magic ) + sizeof( version );
 }
 
+// hash of one event value, summed independently of the order of the events
+uint64_t _hashEvent( const size_t index, const float value )
+{
+    uint32_t bits;
+    ::memcpy( &bits, &value, sizeof( bits ));
+
+    // splitmix64 finalizer
+    uint64_t hash = ( uint64_t( index ) << 32 ) ^ bits;
+    hash = ( hash ^ ( hash >> 30 )) * 0xbf58476d1ce4e5b9ull;
+    hash = ( hash ^ ( hash >> 27 )) * 0x94d049bb133111ebull;
+    return hash ^ ( hash >> 31 );
+}
+
 }
 
 namespace fivox
@@ -76,28 +96,134 @@ public:
         POSY,
         POSZ,
         RADIUS,
-        VALUE,
         NUM_OFFSETS
     };
 
+    /**
+     * The positions and radii of the events, which usually do not change
+     * between frames. Shared with snapshots and copied on write.
+     */
+    struct Geometry
+    {
+        Events events;
+#ifdef USE_BOOST_GEOMETRY
+        RTree rtree;
+        lunchbox::Lock rtreeLock;
+#endif
+    };
+
     explicit Impl( const URIHandler& params )
         : dt( params.getDt( ))
         , duration( params.getDuration( ))
         , currentTime( -1.f )
+        , nextTime( std::numeric_limits< float >::quiet_NaN( ))
         , cutOffDistance( params.getCutoffDistance( ))
         , alignBoundary( 32 )
         , numEvents( 0 )
         , allocSize( 0 )
+        , geometry( std::make_shared< Geometry >( ))
+        , loadedTime( std::numeric_limits< float >::quiet_NaN( ))
+        , maxFrames( params.getFrameCacheSize( ))
     {}
 
-    void resize( const size_t numEvents_ )
+    // snapshot of the given source, sharing its geometry
+    Impl( const Impl& from )
+        : dt( from.dt )
+        , duration( from.duration )
+        , currentTime( from.currentTime )
+        , nextTime( std::numeric_limits< float >::quiet_NaN( ))
+        , cutOffDistance( from.cutOffDistance )
+        , alignBoundary( from.alignBoundary )
+        , numEvents( from.numEvents )
+        , allocSize( from.numEvents )
+        , geometry( from.geometry )
+        , values( allocate( numEvents ))
+        , boundingBox( from.boundingBox )
+        // the values are final, load() on the shared snapshot returns early
+        , loadedTime( from.currentTime )
+        , maxFrames( 0 )
     {
-        numEvents = numEvents_;
-        if( numEvents_ < allocSize )
+        ::memcpy( values.get(), from.values.get(), numEvents * sizeof( float ));
+    }
+
+    // proxies of the events of the given source, see createProxies()
+    Impl( const Impl& from, const float cellSize )
+        : dt( from.dt )
+        , duration( from.duration )
+        , currentTime( from.currentTime )
+        , nextTime( std::numeric_limits< float >::quiet_NaN( ))
+        , cutOffDistance( from.cutOffDistance )
+        , alignBoundary( from.alignBoundary )
+        , numEvents( 0 )
+        , allocSize( 0 )
+        , geometry( std::make_shared< Geometry >( ))
+        , loadedTime( from.currentTime ) // final values, as for snapshots
+        , maxFrames( 0 )
+    {
+        struct Proxy
+        {
+            Vector3f weightedPosition;
+            Vector3f position;
+            float weight;
+            float value;
+            size_t count;
+        };
+        boundingBox = from.boundingBox;
+        if( from.numEvents == 0 )
             return;
 
-        allocSize = numEvents_;
-        const size_t size = numEvents * EventOffsets::NUM_OFFSETS;
+        std::vector< Proxy > proxies;
+        std::unordered_map< uint64_t, size_t > cells;
+
+        const Vector3f& origin = from.boundingBox.getMin();
+        const Vector3f& extent = from.boundingBox.getSize();
+        const uint64_t numCells[3] = { uint64_t( extent[0] / cellSize ) + 1,
+                                       uint64_t( extent[1] / cellSize ) + 1,
+                                       uint64_t( extent[2] / cellSize ) + 1 };
+
+        const float* posx = from.getPositionsX();
+        const float* posy = from.getPositionsY();
+        const float* posz = from.getPositionsZ();
+        const float* vals = from.getValues();
+        for( size_t i = 0; i < from.numEvents; ++i )
+        {
+            const Vector3f position( posx[i], posy[i], posz[i] );
+            const Vector3f cell = ( position - origin ) / cellSize;
+            uint64_t index[3];
+            for( size_t j = 0; j < 3; ++j )
+                index[j] = std::min( uint64_t( std::max( cell[j], 0.f )),
+                                     numCells[j] - 1 );
+
+            const uint64_t key = ( index[2] * numCells[1] + index[1] ) *
+                                 numCells[0] + index[0];
+            const auto inserted = cells.emplace( key, proxies.size( ));
+            if( inserted.second )
+                proxies.push_back( Proxy{ Vector3f( 0.f ), Vector3f( 0.f ),
+                                          0.f, 0.f, 0 });
+
+            Proxy& proxy = proxies[ inserted.first->second ];
+            const float weight = std::abs( vals[i] );
+            proxy.weightedPosition += position * weight;
+            proxy.position += position;
+            proxy.weight += weight;
+            proxy.value += vals[i];
+            ++proxy.count;
+        }
+
+        resize( proxies.size( ));
+        for( size_t i = 0; i < proxies.size(); ++i )
+        {
+            const Proxy& proxy = proxies[i];
+            const Vector3f& position = proxy.weight > 0.f ?
+                proxy.weightedPosition / proxy.weight :
+                proxy.position / float( proxy.count );
+            update( i, position, cellSize * .5f, proxy.value );
+        }
+        boundingBox = from.boundingBox; // update() only extends it
+    }
+
+    Events allocate( const size_t size ) const
+    {
         void* ptr;
         if( posix_memalign( &ptr, alignBoundary, size * sizeof(float) ))
         {
@@ -107,7 +233,34 @@ public:
             if( !ptr )
                 LBTHROW( std::bad_alloc( ));
         }
-        events.reset((float*) ptr );
+        return Events((float*) ptr );
+    }
+
+    void resize( const size_t numEvents_ )
+    {
+        invalidateFrames();
+        numEvents = numEvents_;
+        if( numEvents_ < allocSize )
+            return;
+
+        allocSize = numEvents_;
+        geometry = std::make_shared< Geometry >();
+        geometry->events = allocate( numEvents * EventOffsets::NUM_OFFSETS );
+        values = allocate( numEvents );
+    }
+
+    // copy the geometry before modifying it if snapshots are using it
+    void unshareGeometry()
+    {
+        if( geometry.use_count() == 1 )
+            return;
+
+        auto copy = std::make_shared< Geometry >();
+        const size_t size = allocSize * EventOffsets::NUM_OFFSETS;
+        copy->events = allocate( size );
+        ::memcpy( copy->events.get(), geometry->events.get(),
+                  size * sizeof( float ));
+        geometry = copy;
     }
 
     bool readAscii( const std::string& filename )
@@ -223,27 +376,27 @@ public:
 
     const float* getPositionsX() const
     {
-        return events.get() + numEvents * EventOffsets::POSX;
+        return geometry->events.get() + numEvents * EventOffsets::POSX;
     }
 
     const float* getPositionsY() const
     {
-        return events.get() + numEvents * EventOffsets::POSY;
+        return geometry->events.get() + numEvents * EventOffsets::POSY;
     }
 
     const float* getPositionsZ() const
     {
-        return events.get() + numEvents * EventOffsets::POSZ;
+        return geometry->events.get() + numEvents * EventOffsets::POSZ;
     }
 
     const float* getRadii() const
     {
-        return events.get() + numEvents * EventOffsets::RADIUS;
+        return geometry->events.get() + numEvents * EventOffsets::RADIUS;
     }
 
     const float* getValues() const
     {
-        return events.get() + numEvents * EventOffsets::VALUE;
+        return values.get();
     }
 
     void update( const size_t i, const Vector3f& pos,
@@ -257,40 +410,196 @@ public:
             return;
         }
 
+        invalidateFrames();
+        unshareGeometry();
+        float* events = geometry->events.get();
+
         boundingBox.merge( pos );
-        events.get()[ i + size * Impl::EventOffsets::POSX ] = pos[0];
-        events.get()[ i + size * Impl::EventOffsets::POSY ] = pos[1];
-        events.get()[ i + size * Impl::EventOffsets::POSZ ] = pos[2];
+        events[ i + size * Impl::EventOffsets::POSX ] = pos[0];
+        events[ i + size * Impl::EventOffsets::POSY ] = pos[1];
+        events[ i + size * Impl::EventOffsets::POSZ ] = pos[2];
 
         // radius is inverted to improve performance at computing time
         // e.g. LFP functor
         if( std::abs( rad ) > std::numeric_limits< float >::epsilon( )) // rad != 0
-            events.get()[i + size * Impl::EventOffsets::RADIUS] =  1.f / rad;
+            events[i + size * Impl::EventOffsets::RADIUS] =  1.f / rad;
 
-        events.get()[ i + size * Impl::EventOffsets::VALUE ] = val;
+        values.get()[ i ] = val;
 
     #ifdef USE_BOOST_GEOMETRY
-        rtree.clear();
+        geometry->rtree.clear();
     #endif
     }
 
+    void update( const size_t first, const size_t count, const float* posX,
+                 const float* posY, const float* posZ,
+                 const float rad, const float val )
+    {
+        float* radii = updatePositions( first, count, posX, posY, posZ, val );
+        if( radii &&
+            std::abs( rad ) > std::numeric_limits< float >::epsilon( ))
+        {
+            std::fill( radii, radii + count, 1.f / rad );
+        }
+    }
+
+    void update( const size_t first, const size_t count, const float* posX,
+                 const float* posY, const float* posZ,
+                 const float* rad, const float val )
+    {
+        float* radii = updatePositions( first, count, posX, posY, posZ, val );
+        if( !radii )
+            return;
+
+        for( size_t i = 0; i < count; ++i )
+            if( std::abs( rad[i] ) > std::numeric_limits< float >::epsilon( ))
+                radii[i] = 1.f / rad[i];
+    }
+
+    void setInverseRadii( const size_t first, const size_t count,
+                          const float* inverseRadii )
+    {
+        const size_t size( numEvents );
+        if( first > size || size - first < count )
+        {
+            LBWARN << "The specified range is not valid. Radii not set"
+                   << std::endl;
+            return;
+        }
+
+        invalidateFrames();
+        unshareGeometry();
+        ::memcpy( geometry->events.get() + first + size * EventOffsets::RADIUS,
+                  inverseRadii, count * sizeof( float ));
+    }
+
+    // @return the radii of the updated events, nullptr if none were updated
+    float* updatePositions( const size_t first, const size_t count,
+                            const float* posX, const float* posY,
+                            const float* posZ, const float val )
+    {
+        const size_t size( numEvents );
+        if( first > size || size - first < count )
+        {
+            LBWARN << "The specified range is not valid. Events not added"
+                   << std::endl;
+            return nullptr;
+        }
+        if( count == 0 )
+            return nullptr;
+
+        invalidateFrames();
+        unshareGeometry();
+        float* events = geometry->events.get();
+
+        const size_t bytes = count * sizeof( float );
+        ::memcpy( events + first + size * EventOffsets::POSX, posX, bytes );
+        ::memcpy( events + first + size * EventOffsets::POSY, posY, bytes );
+        ::memcpy( events + first + size * EventOffsets::POSZ, posZ, bytes );
+
+        Vector3f min( posX[0], posY[0], posZ[0] );
+        Vector3f max( min );
+        for( size_t i = 1; i < count; ++i )
+        {
+            min[0] = std::min( min[0], posX[i] );
+            min[1] = std::min( min[1], posY[i] );
+            min[2] = std::min( min[2], posZ[i] );
+            max[0] = std::max( max[0], posX[i] );
+            max[1] = std::max( max[1], posY[i] );
+            max[2] = std::max( max[2], posZ[i] );
+        }
+        boundingBox.merge( min );
+        boundingBox.merge( max );
+
+        std::fill( values.get() + first, values.get() + first + count, val );
+
+    #ifdef USE_BOOST_GEOMETRY
+        geometry->rtree.clear();
+    #endif
+        return events + first + size * EventOffsets::RADIUS;
+    }
+
+    // forget the loaded frames once the events are modified by the source
+    void invalidateFrames()
+    {
+        ++eventsVersion;
+        loadedTime = std::numeric_limits< float >::quiet_NaN();
+        frames.clear();
+    }
+
+    // @return true if the values of the given time are loaded or restored
+    bool restoreFrame( const float time )
+    {
+        if( time == loadedTime )
+            return true;
+
+        for( auto i = frames.begin(); i != frames.end(); ++i )
+        {
+            if( i->time != time )
+                continue;
+
+            ::memcpy( values.get(), i->values.get(),
+                      numEvents * sizeof( float ));
+            frames.splice( frames.begin(), frames, i );
+            loadedTime = time;
+            valuesRestored = true;
+            return true;
+        }
+        return false;
+    }
+
+    void storeFrame( const float time )
+    {
+        loadedTime = time;
+        if( maxFrames == 0 )
+            return;
+
+        // reuse the memory of the least recently used frame
+        Frame frame{ time, nullptr };
+        if( frames.size() >= maxFrames )
+        {
+            frame.values = std::move( frames.back().values );
+            frames.pop_back();
+        }
+        else
+            frame.values = allocate( numEvents );
+
+        ::memcpy( frame.values.get(), values.get(),
+                  numEvents * sizeof( float ));
+        frames.push_front( std::move( frame ));
+    }
+
     float dt;
     float duration;
     float currentTime;
+    float nextTime;
     const float cutOffDistance;
 
     const size_t alignBoundary;
     size_t numEvents;
     size_t allocSize;
-    Events events;
+    std::shared_ptr< Geometry > geometry;
+    Events values;
     AABBf boundingBox;
 
-#ifdef USE_BOOST_GEOMETRY
-    typedef bgi::rtree< Value, bgi::rstar< maxElemInNode, minElemInNode > > RTree;
-    RTree rtree;
+    /** The values of recently loaded frames, most recently used first. */
+    struct Frame
+    {
+        float time;
+        Events values;
+    };
+    std::list< Frame > frames;
+    float loadedTime; // of the current values, NaN if not a complete frame
+    const size_t maxFrames;
+    size_t eventsVersion = 0;
+    bool valuesRestored = false; // since the last _load()
 
+#ifdef USE_BOOST_GEOMETRY
     void buildRTree()
     {
+        // the geometry may be shared with snapshots sampled concurrently
+        lunchbox::ScopedWrite mutex( geometry->rtreeLock );
+        RTree& rtree = geometry->rtree;
         if( !rtree.empty( ))
             return;
 
@@ -314,17 +623,41 @@ public:
 #endif
 };
 
+/** Read-only events derived from an EventSource at the time of creation. */
+class EventSource::Snapshot : public EventSource
+{
+public:
+    Snapshot( const EventSource& source, std::unique_ptr< Impl > impl )
+        : EventSource( std::move( impl ))
+        , _timeRange( source._getTimeRange( ))
+        , _type( source._getType( ))
+    {}
+
+private:
+    Vector2f _getTimeRange() const final { return _timeRange; }
+    ssize_t _load( size_t, size_t ) final { return getNumEvents(); }
+    SourceType _getType() const final { return _type; }
+    size_t _getNumChunks() const final { return 1; }
+
+    const Vector2f _timeRange;
+    const SourceType _type;
+};
+
 EventSource::EventSource( const URIHandler& params )
     : _impl( new EventSource::Impl( params ))
 {}
 
+EventSource::EventSource( std::unique_ptr< Impl > impl )
+    : _impl( std::move( impl ))
+{}
+
 EventSource::~EventSource()
 {}
 
 float& EventSource::operator[]( const size_t index )
 {
-    return _impl->events.get()[ _impl->numEvents * Impl::EventOffsets::VALUE +
-                                index ];
+    _impl->loadedTime = std::numeric_limits< float >::quiet_NaN();
+    return _impl->values.get()[ index ];
 }
 
 size_t EventSource::getNumEvents() const
@@ -361,7 +694,7 @@ EventValues EventSource::findEvents( const AABBf& area LB_UNUSED ) const
 {
     EventValues eventValues;
 #ifdef USE_BOOST_GEOMETRY
-    if( !_impl->rtree.empty( ))
+    if( !_impl->geometry->rtree.empty( ))
     {
         const Vector3f& p1 = area.getMin();
         const Vector3f& p2 = area.getMax();
@@ -371,7 +704,8 @@ EventValues EventSource::findEvents( const AABBf& area LB_UNUSED ) const
         static lunchbox::a_ssize_t maxHits( 0 );
         std::vector< Value > hits;
         hits.reserve( maxHits );
-        _impl->rtree.query( bgi::intersects( query ), std::back_inserter( hits ));
+        _impl->geometry->rtree.query( bgi::intersects( query ),
+                                      std::back_inserter( hits ));
         maxHits = std::max( size_t(maxHits), hits.size( ));
 
         eventValues.reserve( hits.size( ));
@@ -393,6 +727,36 @@ EventValues EventSource::findEvents( const AABBf& area LB_UNUSED ) const
     return eventValues;
 }
 
+uint64_t EventSource::getFingerprint( const AABBf& area ) const
+{
+    uint64_t fingerprint = 0;
+    const float* values = getValues();
+#ifdef USE_BOOST_GEOMETRY
+    if( !_impl->geometry->rtree.empty( ))
+    {
+        const Vector3f& p1 = area.getMin();
+        const Vector3f& p2 = area.getMax();
+        const Box query( Point( p1[0], p1[1], p1[2] ),
+                         Point( p2[0], p2[1], p2[2] ));
+
+        std::vector< Value > hits;
+        _impl->geometry->rtree.query( bgi::intersects( query ),
+                                      std::back_inserter( hits ));
+        for( const Value& value : hits )
+            fingerprint += _hashEvent( value.second, values[value.second] );
+        return fingerprint;
+    }
+#endif
+
+    const float* posx = getPositionsX();
+    const float* posy = getPositionsY();
+    const float* posz = getPositionsZ();
+    for( size_t i = 0; i < getNumEvents(); ++i )
+        if( area.isIn( Vector3f( posx[i], posy[i], posz[i] )))
+            fingerprint += _hashEvent( i, values[i] );
+    return fingerprint;
+}
+
 void EventSource::setBoundingBox( const AABBf& boundingBox )
 {
     _impl->boundingBox = boundingBox;
@@ -419,6 +783,27 @@ void EventSource::update( const size_t i, const Vector3f& pos,
     _impl->update( i, pos, rad, val );
 }
 
+void EventSource::update( const size_t first, const size_t count,
+                          const float* posX, const float* posY,
+                          const float* posZ, const float rad, const float val )
+{
+    _impl->update( first, count, posX, posY, posZ, rad, val );
+}
+
+void EventSource::update( const size_t first, const size_t count,
+                          const float* posX, const float* posY,
+                          const float* posZ, const float* radii,
+                          const float val )
+{
+    _impl->update( first, count, posX, posY, posZ, radii, val );
+}
+
+void EventSource::setInverseRadii( const size_t first, const size_t count,
+                                   const float* inverseRadii )
+{
+    _impl->setInverseRadii( first, count, inverseRadii );
+}
+
 void EventSource::buildRTree()
 {
 #ifdef USE_BOOST_GEOMETRY
@@ -426,6 +811,31 @@ void EventSource::buildRTree()
 #endif
 }
 
+bool EventSource::hasRTree() const
+{
+#ifdef USE_BOOST_GEOMETRY
+    lunchbox::ScopedRead mutex( _impl->geometry->rtreeLock );
+    return !_impl->geometry->rtree.empty();
+#else
+    return false;
+#endif
+}
+
+EventSourcePtr EventSource::createSnapshot() const
+{
+    return std::make_shared< Snapshot >(
+        *this, std::unique_ptr< Impl >( new Impl( *_impl )));
+}
+
+EventSourcePtr EventSource::createProxies( const float cellSize ) const
+{
+    if( cellSize <= 0.f )
+        LBTHROW( std::invalid_argument( "Proxy cell size must be positive" ));
+
+    return std::make_shared< Snapshot >(
+        *this, std::unique_ptr< Impl >( new Impl( *_impl, cellSize )));
+}
+
 bool EventSource::setFrame( const uint32_t frame )
 {
     if( !isInFrameRange( frame ))
@@ -439,6 +849,16 @@ bool EventSource::setFrame( const uint32_t frame )
 void EventSource::setTime( const float time )
 {
     _impl->currentTime = time;
+    _impl->nextTime = std::numeric_limits< float >::quiet_NaN();
+}
+
+bool EventSource::setNextFrame( const uint32_t frame )
+{
+    if( !isInFrameRange( frame ))
+        return false;
+
+    _impl->nextTime = _getTimeRange().x() + getDt() * frame;
+    return true;
 }
 
 Vector2ui EventSource::getFrameRange() const
@@ -480,6 +900,16 @@ void EventSource::setDt( const float dt )
     _impl->dt = dt;
 }
 
+bool EventSource::_valuesRestored() const
+{
+    return _impl->valuesRestored;
+}
+
+void EventSource::_invalidateFrames()
+{
+    _impl->invalidateFrames();
+}
+
 float EventSource::getDuration() const
 {
     return _impl->duration;
@@ -490,6 +920,11 @@ float EventSource::getCurrentTime() const
     return _impl->currentTime;
 }
 
+float EventSource::getNextTime() const
+{
+    return _impl->nextTime;
+}
+
 ssize_t EventSource::load( const size_t chunkIndex, const size_t numChunks )
 {
     if( numChunks == 0 )
@@ -497,12 +932,27 @@ ssize_t EventSource::load( const size_t chunkIndex, const size_t numChunks )
                      "EventSource::load: numChunks must be > 0" ));
     if( chunkIndex + numChunks > getNumChunks( ))
         LBTHROW( std::out_of_range( "EventSource::load: Out of range" ));
-    return _load( chunkIndex, numChunks );
+
+    // the values may only hold a part of a frame afterwards
+    _impl->loadedTime = std::numeric_limits< float >::quiet_NaN();
+    const ssize_t numLoaded = _load( chunkIndex, numChunks );
+    _impl->valuesRestored = false;
+    return numLoaded;
 }
 
 ssize_t EventSource::load()
 {
-    return load( 0, getNumChunks( ));
+    const float time = _impl->currentTime;
+    if( _impl->restoreFrame( time ))
+        return getNumEvents();
+
+    const size_t version = _impl->eventsVersion;
+    const ssize_t numLoaded = load( 0, getNumChunks( ));
+
+    // sources modifying their events while loading are not cached
+    if( numLoaded >= 0 && version == _impl->eventsVersion )
+        _impl->storeFrame( time );
+    return numLoaded;
 }
 
 size_t EventSource::getNumChunks() const
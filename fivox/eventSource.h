@@ -51,7 +51,8 @@ public:
 
     /**
      * Get a reference to the value of an event contained in the EventSource
-     * by its index.
+     * by its index. The next load() reloads or restores the values of its
+     * time, as they may be modified through the reference.
      *
      * @param index Index of the event whose value will be returned
      * @return value of the event stored in the EventSource with the
@@ -90,6 +91,18 @@ public:
      */
     FIVOX_API EventValues findEvents( const AABBf& area ) const;
 
+    /**
+     * Compute a fingerprint of the values of all events in the given area.
+     *
+     * The fingerprint changes if any of these values change, which is used to
+     * reuse volumes sampled for another time. Uses the RTree if built, see
+     * buildRTree(), all events are tested otherwise.
+     *
+     * @param area The query bounding box.
+     * @return The fingerprint of the values, 0 if no events are in the area.
+     */
+    FIVOX_API uint64_t getFingerprint( const AABBf& area ) const;
+
     /**
      * Set bounding box of upcoming events. This overwrites any existing
      * bounding box. It can be used to set a bounding box before
@@ -118,6 +131,55 @@ public:
      */
     FIVOX_API void update( size_t i, const Vector3f& pos, float rad, float val = 0.f );
 
+    /**
+     * Update the positions of a range of events at once, and give them all
+     * the same radius and value. Update also the bounding box to include the
+     * new positions. The range should be within the size used in resize().
+     * Not thread safe.
+     *
+     * @param first the index of the first event that will be updated
+     * @param count the number of events to update
+     * @param posX the x coordinates of the count event positions
+     * @param posY the y coordinates of the count event positions
+     * @param posZ the z coordinates of the count event positions
+     * @param rad the radius of the events
+     * @param val the value of the events
+     */
+    FIVOX_API void update( size_t first, size_t count, const float* posX,
+                           const float* posY, const float* posZ,
+                           float rad, float val );
+
+    /**
+     * Update a range of events at once, each with its own radius, and give
+     * them all the same value. Update also the bounding box to include the
+     * new positions. The range should be within the size used in resize().
+     * Not thread safe.
+     *
+     * @param first the index of the first event that will be updated
+     * @param count the number of events to update
+     * @param posX the x coordinates of the count event positions
+     * @param posY the y coordinates of the count event positions
+     * @param posZ the z coordinates of the count event positions
+     * @param radii the radii of the count events
+     * @param val the value of the events
+     */
+    FIVOX_API void update( size_t first, size_t count, const float* posX,
+                           const float* posY, const float* posZ,
+                           const float* radii, float val );
+
+    /**
+     * Set the inverse radii (1/radius) of a range of events, e.g. as returned
+     * by getRadii() of another source. The range should be within the size
+     * used in resize().
+     * Not thread safe.
+     *
+     * @param first the index of the first event that will be updated
+     * @param count the number of events to update
+     * @param inverseRadii the inverse radii of the count events
+     */
+    FIVOX_API void setInverseRadii( size_t first, size_t count,
+                                    const float* inverseRadii );
+
     /**
      * @internal Called before data is read. Not thread safe.
      * Build an RTree so it can be used from findEvents() (depends
@@ -125,6 +187,43 @@ public:
      */
     FIVOX_API void buildRTree();
 
+    /**
+     * @return true if an RTree of the events is built, which findEvents() and
+     *         getFingerprint() use instead of testing all events.
+     */
+    FIVOX_API bool hasRTree() const;
+
+    /**
+     * Create a read-only snapshot of the events currently loaded.
+     *
+     * The snapshot shares the positions and radii of the events with this
+     * source, and holds a copy of their current values. It can be sampled
+     * while this source loads other frames, for example to sample several
+     * frames concurrently. Loading data into the snapshot does nothing.
+     * Not thread safe with respect to this source.
+     *
+     * @return the new snapshot.
+     */
+    FIVOX_API EventSourcePtr createSnapshot() const;
+
+    /**
+     * Create read-only proxy events aggregating the events currently loaded.
+     *
+     * The events are grouped in the cells of a regular grid aligned with the
+     * bounding box. Each non-empty cell gives one proxy event, with the sum of
+     * the values of its events, their centroid weighted by the absolute values
+     * and half the cell size as radius. Grids with cell sizes differing by
+     * powers of two form an octree of aggregated events. Sampling the proxies
+     * at a voxel spacing of about the cell size approximates sampling all
+     * events at a fraction of the cost.
+     * Not thread safe with respect to this source.
+     *
+     * @param cellSize the size of the grid cells.
+     * @return the new proxy events.
+     * @throw std::invalid_argument if the cell size is not positive.
+     */
+    FIVOX_API EventSourcePtr createProxies( float cellSize ) const;
+
     /**
      * Given a frame number, update the event source with new events to be
      * sampled.
@@ -143,6 +242,18 @@ public:
      */
     FIVOX_API void setTime( float time );
 
+    /**
+     * Hint the frame to be loaded after the current one.
+     *
+     * Report-based sources read this frame in the background while the
+     * current one is sampled. The hint is reset by setFrame() and setTime(),
+     * so it has to be given after them.
+     *
+     * @param frame The frame number to be loaded next.
+     * @return true if the frame is within the range of the data source.
+     */
+    FIVOX_API bool setNextFrame( uint32_t frame );
+
     /**
      * Gets the valid frame range according to data. The valid frames are in the
      * [a, b) range
@@ -172,6 +283,12 @@ public:
     /** @return the current time from setTime() in milliseconds. */
     FIVOX_API float getCurrentTime() const;
 
+    /**
+     * @return the time in milliseconds of the frame hinted by setNextFrame(),
+     *         NaN if none.
+     */
+    FIVOX_API float getNextTime() const;
+
     /**
      * Load and update events for the given chunks of the data source.
      *
@@ -186,6 +303,10 @@ public:
     /**
      * Load and update all events of the current frame.
      *
+     * The values of the most recently loaded frames are kept, so loading the
+     * same time again does not read the data source until the events are
+     * modified using resize() or update().
+     *
      * @return the number of updated events, or -1 if the load failed.
      */
     FIVOX_API ssize_t load();
@@ -253,9 +374,25 @@ protected:
      */
     void setDt( float dt );
 
+    /**
+     * @return true if the values were restored from the recently loaded
+     *         frames since the last _load(), i.e. they do not hold the values
+     *         of the last _load() anymore.
+     */
+    bool _valuesRestored() const;
+
+    /**
+     * Forget the recently loaded frames, e.g. when a parameter affecting the
+     * values of the events changes, so the next load() reloads them.
+     */
+    void _invalidateFrames();
+
 private:
     class Impl;
+    class Snapshot;
     std::unique_ptr< Impl > _impl;
+
+    explicit EventSource( std::unique_ptr< Impl > impl );
 };
 
 } // end namespace fivox
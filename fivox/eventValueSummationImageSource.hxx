@@ -49,7 +49,6 @@ void EventValueSummationImageSource< TImage >::GenerateData()
     const auto numChunks = source->getNumChunks();
     itk::ProgressReporter progress( this, 0, numChunks );
     size_t totalEvents = 0;
-    typename TImage::PixelType maxValue = 0;
 
     // start with batch size of at most 10, adapts to target time wrt loading
     // time of event source
@@ -75,10 +74,7 @@ void EventValueSummationImageSource< TImage >::GenerateData()
             typename Superclass::ImageIndexType index;
             if( image->TransformPhysicalPointToIndex( point, index ))
             {
-                const typename TImage::PixelType value =
-                        image->GetPixel( index ) + values[j];
-                maxValue = std::max( maxValue, value );
-                image->SetPixel( index, value );
+                image->SetPixel( index, image->GetPixel( index ) + values[j] );
             }
         }
 
@@ -97,9 +93,18 @@ void EventValueSummationImageSource< TImage >::GenerateData()
         batchSize = std::min( batchSize, numChunks - i );
     }
 
+    // statistics of the final voxel values, which are only known once all
+    // events are summed up
+    VolumeStatistics& statistics = Superclass::_statistics;
+    statistics.reset( Superclass::_histogramEnabled );
+    const typename TImage::PixelType* voxels = image->GetBufferPointer();
+    const size_t numVoxels = image->GetBufferedRegion().GetNumberOfPixels();
+    for( size_t i = 0; i < numVoxels; ++i )
+        statistics.add( voxels[i] );
+
     LBINFO << "Voxelized " << totalEvents << " events for "
-           << numChunks << " chunks, max value "
-           << size_t( maxValue ) << std::endl;
+           << numChunks << " chunks, values in [" << statistics.getMin()
+           << ", " << statistics.getMax() << "]" << std::endl;
 }
 
 } // end namespace fivox
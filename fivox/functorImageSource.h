@@ -68,9 +68,11 @@ protected:
             itk::ThreadIdType threadId ) override;
 
     void BeforeThreadedGenerateData() override;
+    void AfterThreadedGenerateData() override;
 
 private:
     FunctorPtr _functor;
+    std::vector< VolumeStatistics > _threadStatistics;
     lunchbox::Monitor< size_t > _completed;
     itk::ImageRegionSplitterBase::Pointer _splitter;
 };
@@ -67,6 +67,7 @@ void FunctorImageSource< TImage >::ThreadedGenerateData(
                           image->GetRequestedRegion().GetSize()[2];
     itk::ProgressReporter progress( this, threadId, nLines );
     size_t totalLines = 0;
+    VolumeStatistics& statistics = _threadStatistics[ threadId ];
 
     while( !i.IsAtEnd( ))
     {
@@ -76,7 +77,9 @@ void FunctorImageSource< TImage >::ThreadedGenerateData(
         typename TImage::PointType point;
         image->TransformIndexToPhysicalPoint( index, point );
 
-        i.Set( (*_functor)( point, spacing ) );
+        const typename TImage::PixelType value = (*_functor)( point, spacing );
+        i.Set( value );
+        statistics.add( value );
 
         ++i;
         if( i.IsAtEndOfLine( ))
@@ -112,6 +115,9 @@ void FunctorImageSource< TImage >::ThreadedGenerateData(
 template< typename TImage >
 void FunctorImageSource< TImage >::BeforeThreadedGenerateData()
 {
+    _threadStatistics.assign( this->GetNumberOfThreads(),
+                              VolumeStatistics( Superclass::_histogramEnabled ));
+
     // load all the data of the current frame
     auto source = Superclass::_eventSource;
     if( !source )
@@ -131,10 +137,19 @@ void FunctorImageSource< TImage >::BeforeThreadedGenerateData()
     }
 
     _completed = 0;
+    _functor->setEventSource( source );
     _functor->beforeGenerate();
     Superclass::_progressObserver->reset();
 }
 
+template< typename TImage >
+void FunctorImageSource< TImage >::AfterThreadedGenerateData()
+{
+    Superclass::_statistics.reset( Superclass::_histogramEnabled );
+    for( const VolumeStatistics& statistics : _threadStatistics )
+        Superclass::_statistics.merge( statistics );
+}
+
 } // end namespace fivox
 
 #endif
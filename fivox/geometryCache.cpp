@@ -0,0 +1,209 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "geometryCache.h"
+#include "eventSource.h"
+
+#include <lunchbox/debug.h>
+#include <lunchbox/log.h>
+#include <lunchbox/memoryMap.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fivox
+{
+namespace
+{
+const std::string _extension( ".fivoxgeometry" );
+const uint32_t _magic = 0xf5b3;
+const uint32_t _version = 1;
+
+/** Header of the cache file, followed by the x, y, z and 1/radius columns. */
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t keyHigh;
+    uint64_t keyLow;
+    uint64_t numEvents;
+    float bbox[6];
+    uint32_t padding[2];
+};
+
+size_t _getSize( const uint64_t numEvents )
+{
+    return sizeof( Header ) + 4 * numEvents * sizeof( float );
+}
+}
+
+class GeometryCache::Impl
+{
+public:
+    explicit Impl( const std::string& directory_ )
+        : directory( directory_ )
+    {
+        if( ::mkdir( directory.c_str(), 0755 ) != 0 && errno != EEXIST )
+        {
+            LBTHROW( std::runtime_error( "Cannot create geometry cache " +
+                                         directory + ": " +
+                                         ::strerror( errno )));
+        }
+    }
+
+    bool load( const servus::uint128_t& key, EventSource& output ) const
+    {
+        const std::string filename = _getFilename( key );
+        struct stat info;
+        if( ::stat( filename.c_str(), &info ) != 0 ||
+            size_t( info.st_size ) < sizeof( Header ))
+        {
+            return false;
+        }
+
+        lunchbox::MemoryMap file;
+        const Header* header = static_cast< const Header* >(
+            file.map( filename ));
+        if( !header || header->magic != _magic ||
+            header->version != _version ||
+            header->keyHigh != key.high() || header->keyLow != key.low() ||
+            file.getSize() != _getSize( header->numEvents ))
+        {
+            LBWARN << "Ignoring invalid geometry cache " << filename
+                   << std::endl;
+            return false;
+        }
+
+        const size_t numEvents = header->numEvents;
+        const float* posX = reinterpret_cast< const float* >( header + 1 );
+        const float* posY = posX + numEvents;
+        const float* posZ = posY + numEvents;
+        const float* radii = posZ + numEvents;
+
+        output.resize( numEvents );
+        output.update( 0, numEvents, posX, posY, posZ, 0.f, 0.f );
+        output.setInverseRadii( 0, numEvents, radii );
+        output.setBoundingBox( AABBf(
+            Vector3f( header->bbox[0], header->bbox[1], header->bbox[2] ),
+            Vector3f( header->bbox[3], header->bbox[4], header->bbox[5] )));
+
+        LBINFO << "Loaded " << numEvents << " events from geometry cache "
+               << filename << std::endl;
+        return true;
+    }
+
+    void store( const servus::uint128_t& key, const EventSource& source ) const
+    {
+        const std::string filename = _getFilename( key );
+        const size_t numEvents = source.getNumEvents();
+        const AABBf& bbox = source.getBoundingBox();
+
+        Header header;
+        ::memset( &header, 0, sizeof( header ));
+        header.magic = _magic;
+        header.version = _version;
+        header.keyHigh = key.high();
+        header.keyLow = key.low();
+        header.numEvents = numEvents;
+        for( size_t i = 0; i < 3; ++i )
+        {
+            header.bbox[i] = bbox.getMin()[i];
+            header.bbox[i + 3] = bbox.getMax()[i];
+        }
+
+        // unique per process, as processes may share the cache directory
+        std::ostringstream tmpName;
+        tmpName << filename << "." << ::getpid() << ".tmp";
+        {
+            lunchbox::MemoryMap file;
+            uint8_t* data = static_cast< uint8_t* >(
+                file.create( tmpName.str(), _getSize( numEvents )));
+            if( !data )
+            {
+                LBWARN << "Cannot create geometry cache " << filename
+                       << std::endl;
+                return;
+            }
+
+            ::memcpy( data, &header, sizeof( header ));
+            data += sizeof( header );
+            const size_t bytes = numEvents * sizeof( float );
+            const float* columns[] = { source.getPositionsX(),
+                                       source.getPositionsY(),
+                                       source.getPositionsZ(),
+                                       source.getRadii() };
+            for( const float* column : columns )
+            {
+                if( bytes > 0 )
+                    ::memcpy( data, column, bytes );
+                data += bytes;
+            }
+        }
+
+        if( ::rename( tmpName.str().c_str(), filename.c_str( )) != 0 )
+        {
+            LBWARN << "Cannot save geometry cache " << filename << ": "
+                   << ::strerror( errno ) << std::endl;
+            ::unlink( tmpName.str().c_str( ));
+            return;
+        }
+        LBINFO << "Saved " << numEvents << " events in geometry cache "
+               << filename << std::endl;
+    }
+
+    const std::string directory;
+
+private:
+    std::string _getFilename( const servus::uint128_t& key ) const
+    {
+        std::ostringstream os;
+        os << directory << "/" << std::hex << std::setfill( '0' )
+           << std::setw( 16 ) << key.high() << std::setw( 16 ) << key.low()
+           << _extension;
+        return os.str();
+    }
+};
+
+GeometryCache::GeometryCache( const std::string& directory )
+    : _impl( new GeometryCache::Impl( directory ))
+{}
+
+GeometryCache::~GeometryCache()
+{}
+
+bool GeometryCache::load( const servus::uint128_t& key,
+                          EventSource& output ) const
+{
+    return _impl->load( key, output );
+}
+
+void GeometryCache::store( const servus::uint128_t& key,
+                           const EventSource& source ) const
+{
+    _impl->store( key, source );
+}
+
+}
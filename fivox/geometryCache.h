@@ -0,0 +1,78 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FIVOX_GEOMETRYCACHE_H
+#define FIVOX_GEOMETRYCACHE_H
+
+#include <fivox/types.h>
+
+#include <servus/uint128_t.h>
+
+#include <memory>
+
+namespace fivox
+{
+
+/**
+ * Persistent cache of event geometries in a directory.
+ *
+ * Each geometry is stored in its own file named after its key, which has to
+ * identify the events and the data they were computed from. A file holds the
+ * bounding box, followed by the x, y and z coordinates and the inverse radii
+ * of the events, and is memory-mapped to load it.
+ */
+class GeometryCache
+{
+public:
+    /**
+     * @param directory the cache directory, created if it does not exist
+     * @throw std::runtime_error if the directory can not be created
+     */
+    explicit GeometryCache( const std::string& directory );
+    ~GeometryCache();
+
+    /**
+     * Load a geometry from the cache.
+     *
+     * The events of the given source are resized to the cached ones, which
+     * get the cached positions, radii and bounding box and a value of 0.
+     *
+     * @param key the key of the geometry
+     * @param output the event source to load the geometry into
+     * @return true if the geometry was found, false otherwise.
+     */
+    bool load( const servus::uint128_t& key, EventSource& output ) const;
+
+    /**
+     * Store the geometry of the events of the given source in the cache.
+     *
+     * @param key the key of the geometry
+     * @param source the events to store
+     */
+    void store( const servus::uint128_t& key, const EventSource& source ) const;
+
+private:
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+}
+
+#endif
@@ -22,15 +22,32 @@
 #define FIVOX_HELPERS_H
 
 #include <fivox/eventSource.h>
+#include <fivox/geometryCache.h>
+#include <fivox/uriHandler.h>
+#include <fivox/version.h>
+
+#include <brain/circuit.h>
 
 #include <brain/neuron/morphology.h>
 #include <brain/neuron/section.h>
 #include <brain/neuron/soma.h>
+#include <brion/blueConfig.h>
 #include <brion/types.h>
 #include <brion/compartmentReport.h>
 
 #include <lunchbox/log.h>
 
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
 namespace fivox
 {
 namespace helpers
@@ -77,11 +94,98 @@ inline FlatInverseMapping computeInverseMapping(
     return mapping;
 }
 
+namespace detail
+{
+/**
+ * Add the events of the sections [begin, end) of the mapping, starting at
+ * the given event index. The events are written to the output in batches,
+ * which are serialized by the given mutex.
+ */
+inline void addCompartmentEvents(
+    const brain::neuron::Morphologies& morphologies,
+    const FlatInverseMapping& mapping, const size_t begin, const size_t end,
+    size_t index, EventSource& output, std::mutex& outputLock,
+    const bool somasOnly )
+{
+    const size_t batchSize = 65536;
+    std::vector< float > posX, posY, posZ, radii;
+    for( auto buffer : { &posX, &posY, &posZ, &radii })
+        buffer->reserve( batchSize );
+    brion::floats samples;
+
+    const auto flush = [&]
+    {
+        if( posX.empty( ))
+            return;
+
+        std::lock_guard< std::mutex > lock( outputLock );
+        output.update( index, posX.size(), posX.data(), posY.data(),
+                       posZ.data(), radii.data(), 0.f );
+        index += posX.size();
+        for( auto buffer : { &posX, &posY, &posZ, &radii })
+            buffer->clear();
+    };
+    const auto add = [&]( const Vector3f& position, const float radius )
+    {
+        posX.push_back( position[0] );
+        posY.push_back( position[1] );
+        posZ.push_back( position[2] );
+        radii.push_back( radius );
+    };
+
+    for( size_t i = begin; i < end; ++i )
+    {
+        size_t offset;
+        uint32_t cellIndex;
+        uint32_t sectionId;
+        uint16_t compartments;
+        std::tie( offset, cellIndex, sectionId, compartments ) = mapping[i];
+
+        const auto& morphology = *morphologies[cellIndex];
+
+        if( sectionId == 0 )
+        {
+            const auto& soma = morphology.getSoma();
+            const Vector3f centroid = soma.getCentroid();
+            const float radius = soma.getMeanRadius();
+            for( size_t k = 0; k != compartments; ++k )
+                add( centroid, radius );
+        }
+        else if( !somasOnly )
+        {
+            samples.clear();
+            // normalized compartment length
+            const float normLength = 1.f / float( compartments );
+            for( float k = normLength * .5f; k < 1.0; k += normLength )
+                samples.push_back( k );
+
+            const auto& neuronSection = morphology.getSection( sectionId );
+
+            // actual compartment length
+            const float compartmentLength =
+                normLength * neuronSection.getLength();
+
+            const auto& points = neuronSection.getSamples( samples );
+            for( const auto& point : points )
+                add( point.get_sub_vector< 3, 0 >(), compartmentLength * .2f );
+        }
+
+        if( posX.size() >= batchSize )
+            flush();
+    }
+    flush();
+}
+}
+
 /**
  * Add one event per simulation compartment to the given event source.
  * The compartment counts are obtained from the report mapping. The event
  * positions are computed from the morphology list.
  *
+ * The event index of each section is computed upfront from the compartment
+ * counts, then the cells are processed in parallel, each writing to its own
+ * range of events.
+ *
  * @param morphologies The list of morphologies. The morphology present at each
  *        index must correspond to the cell at the same index in the report
  *        mapping.
@@ -96,68 +200,241 @@ inline void addCompartmentEvents(
     const brion::CompartmentReport& report, EventSource& output,
     const bool somasOnly = false )
 {
-    size_t size = 0;
     const auto& mapping = computeInverseMapping( report );
-    // first loop over the mapping to compute the number of elements
-    for( const auto& i : mapping )
+
+    // index of the first event of each section
+    std::vector< size_t > firstEvents( mapping.size() + 1 );
+    size_t size = 0;
+    for( size_t i = 0; i != mapping.size(); ++i )
     {
-        size_t offset;
-        uint32_t cellIndex;
-        uint32_t sectionId;
-        uint16_t compartments;
-        std::tie( offset, cellIndex, sectionId, compartments ) = i;
+        firstEvents[i] = size;
+        if( !somasOnly || std::get< 2 >( mapping[i] ) == 0 )
+            size += std::get< 3 >( mapping[i] );
+    }
+    firstEvents.back() = size;
+    output.resize( size );
 
-        if( somasOnly && sectionId != 0 )
+    // split the sections into tasks of whole cells with about the same
+    // number of events
+    const size_t numTasks = 4 * std::max( std::thread::hardware_concurrency(),
+                                          1u );
+    std::mutex outputLock;
+    std::vector< std::future< void >> tasks;
+    size_t begin = 0;
+    for( size_t task = 1; task <= numTasks && begin < mapping.size(); ++task )
+    {
+        size_t end = mapping.size();
+        if( task < numTasks )
+        {
+            end = std::lower_bound( firstEvents.begin() + begin,
+                                    firstEvents.end() - 1,
+                                    size * task / numTasks ) -
+                  firstEvents.begin();
+            while( end > begin && end < mapping.size() &&
+                   std::get< 1 >( mapping[end] ) ==
+                   std::get< 1 >( mapping[end - 1] ))
+            {
+                ++end;
+            }
+        }
+        if( end == begin )
             continue;
 
-        size += compartments;
+        tasks.push_back( std::async( std::launch::async,
+            [&morphologies, &mapping, &output, &outputLock, begin, end,
+             somasOnly, &firstEvents]
+            {
+                detail::addCompartmentEvents( morphologies, mapping, begin,
+                                              end, firstEvents[begin], output,
+                                              outputLock, somasOnly );
+            }));
+        begin = end;
     }
-    output.resize( size );
 
-    size_t index = 0;
-    // second loop to add the actual events
-    for( const auto& i : mapping )
+    for( auto& task : tasks )
+        task.get();
+}
+
+namespace detail
+{
+/** 64-bit FNV-1a hash of the given data, continuing from the given hash. */
+inline uint64_t hash( const void* data, const size_t size,
+                      uint64_t hash = 0xcbf29ce484222325ull )
+{
+    const uint8_t* bytes = static_cast< const uint8_t* >( data );
+    for( size_t i = 0; i < size; ++i )
+        hash = ( hash ^ bytes[i] ) * 0x100000001b3ull;
+    return hash;
+}
+
+/**
+ * @return the hash of the sizes and modification times of the circuit files
+ *         the geometry of the given cells is computed from: the BlueConfig,
+ *         the circuit and the morphologies.
+ */
+inline uint64_t hashCircuitFiles( const URIHandler& params,
+                                  const brion::GIDSet& gids )
+{
+    const brion::BlueConfig& config = params.getConfig();
+    std::vector< std::string > files = {
+        params.getConfigPath(), config.getCircuitSource().getPath(),
+        config.getMorphologySource().getPath() };
+    const brain::Circuit circuit( config );
+    for( const URI& uri : circuit.getMorphologyURIs( gids ))
+        files.push_back( uri.getPath( ));
+
+    uint64_t filesHash = 0xcbf29ce484222325ull;
+    for( const std::string& file : files )
     {
-        size_t offset;
-        uint32_t cellIndex;
-        uint32_t sectionId;
-        uint16_t compartments;
-        std::tie( offset, cellIndex, sectionId, compartments ) = i;
+        filesHash = hash( file.data(), file.size(), filesHash );
+        struct stat info;
+        if( ::stat( file.c_str(), &info ) != 0 )
+            continue;
+        const int64_t size = info.st_size;
+        const int64_t time = info.st_mtime;
+        filesHash = hash( &size, sizeof( size ), filesHash );
+        filesHash = hash( &time, sizeof( time ), filesHash );
+    }
+    return filesHash;
+}
 
-        const auto& morphology = *morphologies[cellIndex];
+/**
+ * @return the key of the compartment events of the given parameters in the
+ *         geometry cache, which identifies the circuit files, the GIDs and
+ *         the report mapping.
+ */
+inline servus::uint128_t getGeometryKey( const URIHandler& params,
+                                         const brion::CompartmentReport& report,
+                                         const bool somasOnly )
+{
+    uint64_t mapping = 0xcbf29ce484222325ull;
+    const brion::GIDSet& gids = report.getGIDs();
+    const auto& offsets = report.getOffsets();
+    const auto& counts = report.getCompartmentCounts();
+    for( const uint32_t gid : gids )
+        mapping = hash( &gid, sizeof( gid ), mapping );
+    for( size_t i = 0; i != offsets.size(); ++i )
+    {
+        mapping = hash( offsets[i].data(),
+                        offsets[i].size() * sizeof( offsets[i][0] ), mapping );
+        mapping = hash( counts[i].data(),
+                        counts[i].size() * sizeof( counts[i][0] ), mapping );
+    }
 
-        if( sectionId == 0 )
+    std::ostringstream os;
+    os << "Fivox " << Version::getString() << ", " << params.getConfigPath()
+       << ", files " << std::hex << hashCircuitFiles( params, gids ) << ", "
+       << std::dec << gids.size() << " GIDs, mapping " << std::hex << mapping
+       << ( somasOnly ? ", somas" : ", compartments" );
+    return servus::make_uint128( os.str( ));
+}
+}
+
+/**
+ * Add one event per simulation compartment of the given report to the given
+ * event source, like addCompartmentEvents().
+ *
+ * If the parameters specify a geometry cache, the events are loaded from it,
+ * and only computed from the morphologies of the circuit if they are not
+ * cached yet. Computed events are then added to the cache.
+ *
+ * @param params The parameters of the circuit and the cache.
+ * @param report The report from which the compartments per section are obtained
+ * @param output The output event source.
+ * @param somasOnly Specify whether the events will be created for the somas
+ *        only or for all the compartments. False by default (load all).
+ */
+inline void loadCompartmentEvents( const URIHandler& params,
+                                   const brion::CompartmentReport& report,
+                                   EventSource& output,
+                                   const bool somasOnly = false )
+{
+    std::unique_ptr< GeometryCache > cache;
+    servus::uint128_t key;
+    const std::string& directory = params.getGeometryCache();
+    if( !directory.empty( ))
+    {
+        try
         {
-            const auto& soma = morphology.getSoma();
-            for( size_t k = 0; k != compartments; ++k )
-                output.update( index++, soma.getCentroid(),
-                               soma.getMeanRadius( ));
-            continue;
+            cache.reset( new GeometryCache( directory ));
+            key = detail::getGeometryKey( params, report, somasOnly );
+            if( cache->load( key, output ))
+                return;
+        }
+        catch( const std::exception& e )
+        {
+            LBWARN << "Computing events without geometry cache: " << e.what()
+                   << std::endl;
+            cache.reset();
         }
+    }
 
-        if( somasOnly )
-            continue;
+    LBINFO << "Loading " << params.getGIDs().size() << " morphologies..."
+           << std::endl;
+    const brain::Circuit circuit( params.getConfig( ));
+    const auto morphologies = circuit.loadMorphologies(
+        params.getGIDs(), brain::Circuit::Coordinates::global );
 
-        brion::floats samples;
-        samples.reserve( compartments );
-        // normalized compartment length
-        const float normLength = 1.f / float( compartments );
-        for( float k = normLength * .5f; k < 1.0; k += normLength )
-            samples.push_back( k );
+    LBINFO << "Creating events..." << std::endl;
+    addCompartmentEvents( morphologies, report, output, somasOnly );
 
-        const auto& neuronSection = morphology.getSection( sectionId );
+    if( cache )
+        cache->store( key, output );
+}
 
-        // actual compartment length
-        const float compartmentLength = normLength * neuronSection.getLength();
+/**
+ * Reads the frames of a compartment report for an event source. The frame
+ * hinted by EventSource::setNextFrame() is read in the background while the
+ * current frame is processed.
+ */
+class FrameLoader
+{
+public:
+    explicit FrameLoader( const brion::CompartmentReport& report )
+        : _report( report )
+        , _nextTime( 0.f )
+    {}
 
-        const auto& points = neuronSection.getSamples( samples );
-        for( const auto& point : points )
+    ~FrameLoader()
+    {
+        if( _next.valid( ))
+            _next.wait();
+    }
+
+    /**
+     * @return the frame of the current time of the given source, nullptr if
+     *         not available.
+     */
+    brion::floatsPtr load( const EventSource& source )
+    {
+        const float time = source.getCurrentTime();
+        brion::floatsPtr frame;
+
+        // the report is never read concurrently, also wait for unused frames
+        if( _next.valid( ))
+        {
+            brion::floatsPtr next = _next.get();
+            if( _nextTime == time )
+                frame = next;
+        }
+        if( !frame )
+            frame = _report.loadFrame( time );
+
+        const float nextTime = source.getNextTime();
+        if( !std::isnan( nextTime ) && nextTime != time )
         {
-            output.update( index++, point.get_sub_vector< 3, 0 >(),
-                           compartmentLength * .2f );
+            _nextTime = nextTime;
+            _next = std::async( std::launch::async, [this, nextTime]
+                                { return _report.loadFrame( nextTime ); });
         }
+        return frame;
     }
-}
+
+private:
+    const brion::CompartmentReport& _report;
+    std::future< brion::floatsPtr > _next;
+    float _nextTime;
+};
 
 }
 }
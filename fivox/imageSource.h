@@ -24,6 +24,7 @@
 #include <fivox/api.h>
 #include <fivox/types.h>
 #include <fivox/progressObserver.h> // member
+#include <fivox/volumeStatistics.h> // member
 
 #include <itkImageSource.h> // base class
 
@@ -93,6 +94,18 @@ public:
     /** @return the resolution of the output volume in voxels per micrometer. */
     FIVOX_API const Vector3f& getResolution() const;
 
+    /**
+     * @return the statistics of the voxel values of the last update, gathered
+     *         while generating the volume. The histogram is only available if
+     *         enabled and supported by the image source.
+     */
+    FIVOX_API const VolumeStatistics& getStatistics() const
+        { return _statistics; }
+
+    /** Enable gathering a histogram in the statistics of the next updates. */
+    FIVOX_API void setHistogramEnabled( const bool enable )
+        { _histogramEnabled = enable; }
+
 protected:
     ImageSource();
     ImageSource( const Self& ) = delete;
@@ -107,6 +120,9 @@ protected:
     Vector3ui _sizeVoxel;
     Vector3f _sizeMicrometer;
     Vector3f _resolution;
+
+    VolumeStatistics _statistics;
+    bool _histogramEnabled;
 };
 } // end namespace fivox
 
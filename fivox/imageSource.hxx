@@ -33,6 +33,7 @@ namespace fivox
 {
 template< typename TImage > ImageSource< TImage >::ImageSource()
     : _progressObserver( ProgressObserver::New( ))
+    , _histogramEnabled( false )
 {
     // set up default size
     static const size_t size = 256;
@@ -58,6 +59,7 @@ template< typename TImage >
 void ImageSource< TImage >::setup( const URIHandler& params )
 {
     _progressObserver->enablePrint();
+    _histogramEnabled = params.getInputPercentiles() != Vector2f( 0.f, 100.f );
 
     const std::string& refVolume = params.getReferenceVolume();
     if( refVolume.empty( ))
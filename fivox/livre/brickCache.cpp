@@ -0,0 +1,241 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "brickCache.h"
+
+#include <lunchbox/debug.h>
+#include <lunchbox/lock.h>
+#include <lunchbox/log.h>
+#include <lunchbox/scopedMutex.h>
+#include <lunchbox/types.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace fivox
+{
+namespace
+{
+const std::string _extension( ".brick" );
+
+std::string _getFilename( const servus::uint128_t& key )
+{
+    std::ostringstream os;
+    os << std::hex << std::setfill( '0' ) << std::setw( 16 ) << key.high()
+       << std::setw( 16 ) << key.low() << _extension;
+    return os.str();
+}
+}
+
+class BrickCache::Impl
+{
+public:
+    Impl( const std::string& directory_, const size_t maxSize_ )
+        : directory( directory_ )
+        , maxSize( maxSize_ )
+        , size( 0 )
+    {
+        if( ::mkdir( directory.c_str(), 0755 ) != 0 && errno != EEXIST )
+        {
+            LBTHROW( std::runtime_error( "Cannot create brick cache " +
+                                         directory + ": " +
+                                         ::strerror( errno )));
+        }
+        _scan();
+
+        lunchbox::ScopedWrite mutex( lock );
+        _evict();
+        LBINFO << "Using brick cache " << directory << " with "
+               << entries.size() << " bricks, " << size / LB_1MB << " of "
+               << maxSize / LB_1MB << " MB used" << std::endl;
+    }
+
+    bool load( const servus::uint128_t& key, void* data, const size_t size_ )
+    {
+        const std::string filename = _getFilename( key );
+        {
+            lunchbox::ScopedWrite mutex( lock );
+            const auto i = entries.find( filename );
+            if( i == entries.end( ))
+                return false;
+            if( i->second.size != size_ )
+            {
+                _remove( i );
+                return false;
+            }
+            lru.splice( lru.begin(), lru, i->second.position );
+        }
+
+        // read without lock, an evicted file stays readable once opened
+        const std::string path = _getPath( filename );
+        std::ifstream file( path.c_str(), std::ios::binary );
+        if( !file.read( static_cast< char* >( data ), size_ ))
+            return false;
+        ::utime( path.c_str(), nullptr ); // keep the usage across sessions
+        return true;
+    }
+
+    void store( const servus::uint128_t& key, const void* data,
+                const size_t size_ )
+    {
+        if( size_ > maxSize )
+            return;
+
+        // write to a temporary file first, so other threads and processes
+        // never read partially written bricks
+        const std::string filename = _getFilename( key );
+        const std::string path = _getPath( filename );
+        std::ostringstream tmpPath;
+        tmpPath << path << '.' << ::getpid() << '.'
+                << std::this_thread::get_id();
+        {
+            std::ofstream file( tmpPath.str().c_str(), std::ios::binary );
+            if( !file.write( static_cast< const char* >( data ), size_ ))
+            {
+                LBWARN << "Cannot write brick to cache " << directory
+                       << std::endl;
+                ::unlink( tmpPath.str().c_str( ));
+                return;
+            }
+        }
+        if( ::rename( tmpPath.str().c_str(), path.c_str( )) != 0 )
+        {
+            ::unlink( tmpPath.str().c_str( ));
+            return;
+        }
+
+        lunchbox::ScopedWrite mutex( lock );
+        const auto i = entries.find( filename );
+        if( i != entries.end( ))
+        {
+            size -= i->second.size;
+            lru.erase( i->second.position );
+            entries.erase( i );
+        }
+        _add( filename, size_ );
+        _evict();
+    }
+
+    struct Entry
+    {
+        std::list< std::string >::iterator position;
+        size_t size;
+    };
+    typedef std::unordered_map< std::string, Entry > Entries;
+
+    const std::string directory;
+    const size_t maxSize;
+
+    lunchbox::Lock lock;
+    std::list< std::string > lru; // most recently used first
+    Entries entries;
+    size_t size;
+
+private:
+    std::string _getPath( const std::string& filename ) const
+    {
+        return directory + "/" + filename;
+    }
+
+    // read the bricks of previous sessions, ordered by their last usage
+    void _scan()
+    {
+        DIR* dir = ::opendir( directory.c_str( ));
+        if( !dir )
+            return;
+
+        std::vector< std::tuple< time_t, std::string, size_t >> files;
+        while( const dirent* entry = ::readdir( dir ))
+        {
+            const std::string filename( entry->d_name );
+            if( filename.size() <= _extension.size() ||
+                filename.compare( filename.size() - _extension.size(),
+                                  _extension.size(), _extension ) != 0 )
+            {
+                continue;
+            }
+
+            struct stat info;
+            if( ::stat( _getPath( filename ).c_str(), &info ) == 0 )
+                files.emplace_back( info.st_mtime, filename, info.st_size );
+        }
+        ::closedir( dir );
+
+        std::sort( files.begin(), files.end( ));
+        for( const auto& file : files )
+            _add( std::get< 1 >( file ), std::get< 2 >( file ));
+    }
+
+    void _add( const std::string& filename, const size_t size_ )
+    {
+        lru.push_front( filename );
+        entries[ filename ] = Entry{ lru.begin(), size_ };
+        size += size_;
+    }
+
+    void _remove( Entries::iterator i )
+    {
+        ::unlink( _getPath( i->first ).c_str( ));
+        size -= i->second.size;
+        lru.erase( i->second.position );
+        entries.erase( i );
+    }
+
+    void _evict()
+    {
+        while( size > maxSize && !lru.empty( ))
+            _remove( entries.find( lru.back( )));
+    }
+};
+
+BrickCache::BrickCache( const std::string& directory, const size_t maxSize )
+    : _impl( new Impl( directory, maxSize ))
+{}
+
+BrickCache::~BrickCache()
+{}
+
+bool BrickCache::load( const servus::uint128_t& key, void* data,
+                       const size_t size )
+{
+    return _impl->load( key, data, size );
+}
+
+void BrickCache::store( const servus::uint128_t& key, const void* data,
+                        const size_t size )
+{
+    _impl->store( key, data, size );
+}
+
+}
@@ -0,0 +1,77 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FIVOX_LIVRE_BRICKCACHE_H
+#define FIVOX_LIVRE_BRICKCACHE_H
+
+#include <servus/uint128_t.h>
+
+#include <memory>
+#include <string>
+
+namespace fivox
+{
+
+/**
+* Persistent cache of sampled bricks in a directory.
+*
+* Each brick is stored in its own file named after its key, which has to
+* identify the brick and the data it was sampled from. The least recently
+* used bricks are removed when the cache exceeds its maximum size; the
+* modification time of the files keeps track of their usage across sessions.
+* Several data sources and processes may share the same cache directory.
+*/
+class BrickCache
+{
+public:
+    /**
+     * @param directory the cache directory, created if it does not exist
+     * @param maxSize the maximum size of all cached bricks in bytes
+     */
+    BrickCache( const std::string& directory, size_t maxSize );
+    ~BrickCache();
+
+    /**
+     * Read a brick from the cache.
+     *
+     * @param key the key of the brick
+     * @param data the buffer to read the brick into
+     * @param size the size of the brick in bytes
+     * @return true if the brick was found with the given size, false otherwise.
+     */
+    bool load( const servus::uint128_t& key, void* data, size_t size );
+
+    /**
+     * Store a brick in the cache, removing the least recently used bricks if
+     * the maximum size is exceeded.
+     *
+     * @param key the key of the brick
+     * @param data the brick data
+     * @param size the size of the brick in bytes
+     */
+    void store( const servus::uint128_t& key, const void* data, size_t size );
+
+private:
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+}
+
+#endif
@@ -19,12 +19,17 @@
  */
 
 #include "dataSource.h"
+#include "brickCache.h"
 
 #include <fivox/eventFunctor.h>
 #include <fivox/helpers.h>
 #include <fivox/imageSource.h>
 #include <fivox/scaleFilter.h>
 #include <fivox/uriHandler.h>
+#include <fivox/version.h>
+#include <fivox/volumeStatistics.h>
+
+#include <brion/blueConfig.h>
 
 #include <livre/core/data/LODNode.h>
 #include <livre/core/data/MemoryUnit.h>
@@ -34,6 +39,19 @@
 #include <lunchbox/scopedMutex.h>
 #include <lunchbox/string.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
 extern "C" int LunchboxPluginGetVersion() { return LIVRECORE_VERSION_ABI; }
 extern "C" bool LunchboxPluginRegister()
 {
@@ -43,26 +61,284 @@ extern "C" bool LunchboxPluginRegister()
 
 namespace fivox
 {
+namespace
+{
+/** Brick data handed to Livre without copying, owning its memory. */
+template< class T > class OwningMemoryUnit : public livre::ConstMemoryUnit
+{
+public:
+    OwningMemoryUnit( T&& owner, const uint8_t* data, const size_t size )
+        : livre::ConstMemoryUnit( data, size )
+        , _owner( std::move( owner ))
+    {}
+
+private:
+    const T _owner;
+};
+
+template< class T >
+livre::MemoryUnitPtr _newMemoryUnit( T owner, const uint8_t* data,
+                                     const size_t size )
+{
+    return std::make_shared< OwningMemoryUnit< T >>( std::move( owner ),
+                                                     data, size );
+}
+
+/** The values of a sampled brick before scaling, kept for downsampling. */
+struct FloatBrick
+{
+    std::vector< float > values;
+    bool accurate; // sampled from all events, not from proxies
+};
+typedef std::shared_ptr< const FloatBrick > FloatBrickPtr;
+typedef std::array< FloatBrickPtr, 8 > FloatBricks; // index x + 2y + 4z
+
+/**
+ * Downsample eight child bricks of the given size into their parent, using a
+ * box filter over the 2x2x2 child voxels of each parent voxel, or a [1 2 1]
+ * binomial approximation of a Gaussian centered on the parent voxel.
+ */
+std::vector< float > _downsample( const FloatBricks& children,
+                                  const vmml::Vector3i& size,
+                                  const bool gaussian )
+{
+    // weights for the child voxels at 2 * index + [-1, 0, 1]
+    static const float box[] = { 0.f, 1.f, 1.f };
+    static const float binomial[] = { 1.f, 2.f, 1.f };
+    const float* weights = gaussian ? binomial : box;
+
+    const auto getValue = [&]( const int32_t x, const int32_t y,
+                               const int32_t z )
+    {
+        const size_t child = x / size[0] + 2 * ( y / size[1] ) +
+                             4 * ( z / size[2] );
+        const size_t index = x % size[0] + size[0] *
+                             ( y % size[1] + size[1] * ( z % size[2] ));
+        return children[ child ]->values[ index ];
+    };
+
+    std::vector< float > values( size.product( ));
+    size_t index = 0;
+    for( int32_t z = 0; z < size[2]; ++z )
+        for( int32_t y = 0; y < size[1]; ++y )
+            for( int32_t x = 0; x < size[0]; ++x )
+            {
+                float sum = 0.f;
+                float weightSum = 0.f;
+                for( int32_t dz = -1; dz <= 1; ++dz )
+                {
+                    const int32_t cz = 2 * z + dz;
+                    if( cz < 0 || cz >= 2 * size[2] )
+                        continue;
+                    for( int32_t dy = -1; dy <= 1; ++dy )
+                    {
+                        const int32_t cy = 2 * y + dy;
+                        if( cy < 0 || cy >= 2 * size[1] )
+                            continue;
+                        for( int32_t dx = -1; dx <= 1; ++dx )
+                        {
+                            const int32_t cx = 2 * x + dx;
+                            const float weight = weights[dx + 1] *
+                                                 weights[dy + 1] *
+                                                 weights[dz + 1];
+                            if( cx < 0 || cx >= 2 * size[0] || weight == 0.f )
+                                continue;
+                            sum += weight * getValue( cx, cy, cz );
+                            weightSum += weight;
+                        }
+                    }
+                }
+                values[ index++ ] = sum / weightSum;
+            }
+    return values;
+}
+}
 
 class DataSource::Impl
 {
 public:
     explicit Impl( const livre::DataSourcePluginData& pluginData )
         : params( pluginData.getURI( ))
-        , source( params.newImageSource< FloatVolume >( ))
-        , scaler( source->GetOutput(), params.getInputRange( ))
-    {}
+        , loader( params.newEventSource( ))
+        , source( params.newImageSource< FloatVolume >( loader ))
+    {
+        _downsampling = params.getDownsampling();
+        if( !_downsampling.empty() && _downsampling != "box" &&
+            _downsampling != "gaussian" )
+        {
+            LBWARN << "Unknown downsample filter '" << _downsampling
+                   << "', sampling all bricks from events" << std::endl;
+            _downsampling.clear();
+        }
+
+        _releasePipeline( _newPipeline( ));
+
+        const std::string& cacheDirectory = params.getCacheDirectory();
+        if( !cacheDirectory.empty( ))
+        {
+            _cache.reset( new BrickCache( cacheDirectory,
+                                          params.getCacheSize( )));
+            _cacheKey = _getCacheKey( pluginData.getURI( ));
+        }
+
+        // the prefetched timesteps and bricks share the memory budget
+        const size_t prefetchSize = params.getPrefetchSize();
+        const size_t frameSize = std::max( loader->getNumEvents(),
+                                           size_t( 1 )) * sizeof( float );
+        _prefetchFrames = std::min( params.getPrefetchFrames(),
+                                    prefetchSize / frameSize );
+        if( params.prefetchBricks( ))
+            _prefetchBricksSize = prefetchSize - _prefetchFrames * frameSize;
+        _reuseCacheSize = params.getReuseCacheSize();
+
+        // without an rtree, the fingerprint of a brick tests all events,
+        // which costs about as much as sampling it
+        if( _reuseCacheSize > 0 )
+        {
+            loader->buildRTree();
+            if( !loader->hasRTree( ))
+            {
+                LBWARN << "Not reusing bricks, which needs an rtree of the "
+                       << "events (boost::geometry)" << std::endl;
+                _reuseCacheSize = 0;
+            }
+        }
+    }
+
+    ~Impl()
+    {
+        _stopPrefetch = true;
+        if( _prefetch.valid( ))
+            _prefetch.wait();
+    }
 
     livre::MemoryUnitPtr sample( const livre::LODNode& node,
                                  const livre::VolumeInformation& info ) const
     {
-        // called from multiple render threads, only have one update running
-        lunchbox::ScopedWrite mutex( _lock );
-        EventSourcePtr loader = source->getEventSource();
-        const uint32_t timeStep = node.getNodeId().getTimeStep();
-        loader->setTime( timeStep );
+        const livre::MemoryUnitPtr prefetched = _updatePlayback( node, info );
+        if( prefetched )
+            return prefetched;
+        return _sampleBrick( node, info );
+    }
 
+    bool update( livre::VolumeInformation& info )
+    {
+        lunchbox::ScopedWrite mutex( _loaderLock );
+        const Vector2ui& frameRange = loader->getFrameRange();
+
+        if( info.frameRange == frameRange )
+            return false;
+
+        if( frameRange[1] > 0 ) // is any frame present
+            info.frameRange = frameRange;
+        return true;
+    }
+
+    const URIHandler params;
+    const EventSourcePtr loader; // only accessed with _loaderLock
+    ImageSourcePtr< FloatVolume > source; // volume setup, not for sampling
+    Vector3f _borders;
+
+private:
+    /** An independent image source and scaler to sample one brick. */
+    struct Pipeline
+    {
+        ImageSourcePtr< FloatVolume > source;
+        ImageSourcePtr< ByteVolume > byteSource; // null if not supported
+        std::unique_ptr< ScaleFilter< ByteVolume >> scaler; // if no byteSource
+    };
+    typedef std::unique_ptr< Pipeline > PipelinePtr;
+
+    /** The events of one timestep, and their proxies for coarse levels. */
+    struct Snapshot
+    {
+        uint32_t timeStep;
+        EventSourcePtr events;
+        std::map< int32_t, EventSourcePtr > proxies; // per level from bottom
+    };
+
+    /** A sampled brick and the fingerprint of the events it depends on. */
+    struct ReusableBrick
+    {
+        uint64_t fingerprint;
+        livre::MemoryUnitPtr data;
+    };
+
+    /** A brick sampled ahead of its request by Livre. */
+    struct PrefetchedBrick
+    {
+        uint32_t timeStep;
+        livre::MemoryUnitPtr data;
+    };
+
+    // number of timesteps kept loaded, e.g. while switching between them, in
+    // addition to the prefetched ones
+    static const size_t _maxSnapshots = 2;
+
+    mutable lunchbox::Lock _loaderLock;
+    mutable std::deque< Snapshot > _snapshots;
+
+    mutable lunchbox::Lock _pipelineLock;
+    mutable std::vector< PipelinePtr > _pipelines;
+
+    std::unique_ptr< BrickCache > _cache; // null if disabled
+    std::string _cacheKey; // identifies the volume and its input data
+
+    std::string _downsampling; // "box" or "gaussian", empty if disabled
+    mutable lunchbox::Lock _floatBrickLock;
+    typedef std::list< std::pair< uint64_t, FloatBrickPtr >> FloatBrickList;
+    mutable FloatBrickList _floatBricks; // most recently used first
+    mutable std::unordered_map< uint64_t, FloatBrickList::iterator >
+        _floatBrickIndex;
+    mutable size_t _floatBricksSize = 0;
+
+    size_t _reuseCacheSize = 0; // bytes, 0 if bricks are not reused
+    mutable lunchbox::Lock _reusableBrickLock;
+    typedef std::list< std::pair< uint64_t, ReusableBrick >> ReusableBrickList;
+    mutable ReusableBrickList _reusableBricks; // most recently used first
+    mutable std::unordered_map< uint64_t, ReusableBrickList::iterator >
+        _reusableBrickIndex;
+
+    size_t _prefetchFrames = 0; // timesteps loaded ahead, 0 if disabled
+    size_t _prefetchBricksSize = 0; // budget of prefetched bricks in bytes
+    mutable lunchbox::Lock _prefetchLock;
+    mutable uint32_t _timeStep = std::numeric_limits< uint32_t >::max();
+    // requested nodes of _timeStep by ID, as many as prefetched bricks fit
+    mutable std::unordered_map< uint64_t, livre::LODNode > _visibleNodes;
+    mutable std::unordered_map< uint64_t, PrefetchedBrick > _prefetchedBricks;
+    mutable size_t _prefetchedSize = 0;
+    mutable std::future< void > _prefetch;
+    mutable std::atomic< bool > _stopPrefetch{ false };
+
+    static size_t _getBrickSize( const livre::VolumeInformation& info )
+    {
         const vmml::Vector3i& voxels = info.maximumBlockSize;
+        return voxels[0] * voxels[1] * voxels[2] * info.compCount *
+               info.getBytesPerVoxel();
+    }
+
+    livre::MemoryUnitPtr _sampleBrick( const livre::LODNode& node,
+                               const livre::VolumeInformation& info ) const
+    {
+        const vmml::Vector3i& voxels = info.maximumBlockSize;
+        const size_t size = _getBrickSize( info );
+        const uint32_t timeStep = node.getNodeId().getTimeStep();
+
+        servus::uint128_t cacheKey;
+        if( _cache )
+        {
+            std::ostringstream os;
+            os << _cacheKey << ", node " << node.getNodeId().getId()
+               << ", timestep " << timeStep << ", block " << voxels;
+            cacheKey = servus::make_uint128( os.str( ));
+
+            std::vector< uint8_t > brick( size );
+            if( _cache->load( cacheKey, brick.data(), size ))
+            {
+                const uint8_t* data = brick.data();
+                return _newMemoryUnit( std::move( brick ), data, size );
+            }
+        }
 
         ByteVolume::SizeType vSize;
         vSize[0] = voxels[0];
@@ -94,41 +370,578 @@ public:
         origin[1] = offset[1];
         origin[2] = offset[2];
 
-        auto volume = source->GetOutput();
-        volume->SetRegions( region );
-        volume->SetSpacing( spacing );
-        volume->SetOrigin( origin );
+        ByteVolume::Pointer output;
+        PipelinePtr pipeline;
+        uint64_t fingerprint = 0;
+        bool reusable = false;
+        const FloatBrickPtr downsampled =
+            _downsampleChildren( node.getNodeId(), voxels );
+        if( downsampled )
+        {
+            output = _scale( *downsampled, region );
+        }
+        else
+        {
+            // called from multiple render threads, which sample concurrently
+            // using their own pipeline on a snapshot of the events
+            const EventSourcePtr events =
+                _getEvents( timeStep, levelFromBottom, spacing[0] );
+
+            // reuse the brick of another timestep if the values of all
+            // events within the cutoff distance did not change, unless the
+            // events have no rtree to find them, e.g. proxies
+            if( _reuseCacheSize > 0 && events->hasRTree( ))
+            {
+                const float margin = spacing[0] * .5f +
+                                     events->getCutOffDistance();
+                const Vector3f extent = Vector3f( voxels ) * spacing[0];
+                fingerprint = events->getFingerprint(
+                    AABBf( offset - margin, offset + extent + margin ));
+                reusable = true;
 
-        source->Modified();
-        scaler.Update();
+                const livre::MemoryUnitPtr reused =
+                    _getReusableBrick( node.getNodeId(), fingerprint );
+                if( reused )
+                    return reused;
+            }
 
-        const size_t size = voxels[0] * voxels[1] * voxels[2] *
-                            info.compCount * info.getBytesPerVoxel();
-        return livre::MemoryUnitPtr( new livre::AllocMemoryUnit(
-                                scaler.GetOutput()->GetBufferPointer(), size ));
+            pipeline = _acquirePipeline();
+            output = _sample( *pipeline, events, region, spacing, origin );
+
+            if( !_downsampling.empty( ))
+            {
+                // keep the values for downsampling into the parent brick
+                const auto volume = pipeline->source->GetOutput();
+                const float* values = volume->GetBufferPointer();
+                FloatBrick brick;
+                brick.values.assign( values, values + volume->
+                                     GetBufferedRegion().GetNumberOfPixels( ));
+                brick.accurate = levelFromBottom <= 0 || !_useProxies();
+                _addFloatBrick( node.getNodeId(), std::move( brick ));
+            }
+        }
+
+        if( _cache )
+            _cache->store( cacheKey, output->GetBufferPointer(), size );
+
+        // the output is detached from the pipeline, which can be reused
+        if( pipeline )
+            _releasePipeline( std::move( pipeline ));
+        const uint8_t* data = output->GetBufferPointer();
+        const livre::MemoryUnitPtr memoryUnit =
+            _newMemoryUnit( output, data, size );
+        if( reusable )
+        {
+            _addReusableBrick( node.getNodeId(), fingerprint, memoryUnit,
+                               size );
+        }
+        return memoryUnit;
     }
 
-    bool update( livre::VolumeInformation& info )
+    // @return the key of the given brick, identical for all timesteps
+    static uint64_t _getReusableKey( const livre::NodeId& nodeId )
     {
-        EventSourcePtr loader = source->getEventSource();
-        lunchbox::ScopedWrite mutex( _lock );
-        const Vector2ui& frameRange = loader->getFrameRange();
+        return livre::NodeId( nodeId.getLevel(), nodeId.getPosition(),
+                              0 ).getId();
+    }
 
-        if( info.frameRange == frameRange )
-            return false;
+    livre::MemoryUnitPtr _getReusableBrick( const livre::NodeId& nodeId,
+                                            const uint64_t fingerprint ) const
+    {
+        lunchbox::ScopedWrite mutex( _reusableBrickLock );
+        const auto i = _reusableBrickIndex.find( _getReusableKey( nodeId ));
+        if( i == _reusableBrickIndex.end() ||
+            i->second->second.fingerprint != fingerprint )
+        {
+            return livre::MemoryUnitPtr();
+        }
+        _reusableBricks.splice( _reusableBricks.begin(), _reusableBricks,
+                                i->second );
+        return i->second->second.data;
+    }
 
-        if( frameRange[1] > 0 ) // is any frame present
-            info.frameRange = frameRange;
-        return true;
+    void _addReusableBrick( const livre::NodeId& nodeId,
+                            const uint64_t fingerprint,
+                            const livre::MemoryUnitPtr& data,
+                            const size_t size ) const
+    {
+        if( size > _reuseCacheSize )
+            return;
+
+        lunchbox::ScopedWrite mutex( _reusableBrickLock );
+        const uint64_t key = _getReusableKey( nodeId );
+        const auto i = _reusableBrickIndex.find( key );
+        if( i != _reusableBrickIndex.end( ))
+        {
+            i->second->second = ReusableBrick{ fingerprint, data };
+            _reusableBricks.splice( _reusableBricks.begin(), _reusableBricks,
+                                    i->second );
+            return;
+        }
+
+        _reusableBricks.emplace_front( key,
+                                       ReusableBrick{ fingerprint, data });
+        _reusableBrickIndex[ key ] = _reusableBricks.begin();
+        while( _reusableBricks.size() * size > _reuseCacheSize )
+        {
+            _reusableBrickIndex.erase( _reusableBricks.back().first );
+            _reusableBricks.pop_back();
+        }
     }
 
-    const URIHandler params;
-    ImageSourcePtr< FloatVolume > source;
-    mutable ScaleFilter< ByteVolume > scaler;
-    Vector3f _borders;
+    /**
+     * Track the timesteps requested by Livre, and start prefetching the
+     * following timesteps when it advances to the next one.
+     *
+     * @return the requested brick if it was prefetched, nullptr otherwise.
+     */
+    livre::MemoryUnitPtr _updatePlayback( const livre::LODNode& node,
+                                    const livre::VolumeInformation& info ) const
+    {
+        if( _prefetchFrames == 0 )
+            return livre::MemoryUnitPtr();
 
-private:
-    mutable lunchbox::Lock _lock;
+        const uint32_t timeStep = node.getNodeId().getTimeStep();
+        lunchbox::ScopedWrite mutex( _prefetchLock );
+        if( timeStep != _timeStep )
+        {
+            const bool sequential = timeStep == _timeStep + 1;
+            _timeStep = timeStep;
+
+            for( auto i = _prefetchedBricks.begin();
+                 i != _prefetchedBricks.end(); )
+            {
+                if( i->second.timeStep >= timeStep )
+                {
+                    ++i;
+                    continue;
+                }
+                _prefetchedSize -= _getBrickSize( info );
+                i = _prefetchedBricks.erase( i );
+            }
+
+            // the bricks of the previous timestep are likely to be visible in
+            // the following ones
+            if( sequential )
+                _startPrefetch( timeStep, info );
+            _visibleNodes.clear();
+        }
+        const size_t maxVisibleNodes = _prefetchBricksSize /
+                                       _getBrickSize( info );
+        if( _visibleNodes.size() < maxVisibleNodes )
+            _visibleNodes.emplace( node.getNodeId().getId(), node );
+
+        const auto i = _prefetchedBricks.find( node.getNodeId().getId( ));
+        if( i == _prefetchedBricks.end( ))
+            return livre::MemoryUnitPtr();
+
+        const livre::MemoryUnitPtr data = i->second.data;
+        _prefetchedSize -= _getBrickSize( info );
+        _prefetchedBricks.erase( i );
+        return data;
+    }
+
+    // called with _prefetchLock held
+    void _startPrefetch( const uint32_t timeStep,
+                         const livre::VolumeInformation& info ) const
+    {
+        // skip if still busy, playback is faster than prefetching anyway
+        if( _prefetch.valid() &&
+            _prefetch.wait_for( std::chrono::seconds( 0 )) !=
+                std::future_status::ready )
+        {
+            return;
+        }
+
+        std::vector< livre::LODNode > nodes;
+        nodes.reserve( _visibleNodes.size( ));
+        for( const auto& visibleNode : _visibleNodes )
+            nodes.push_back( visibleNode.second );
+
+        _prefetch = std::async( std::launch::async,
+                                [this, timeStep, nodes, info]
+        {
+            try
+            {
+                _prefetchTimeSteps( timeStep, nodes, info );
+            }
+            catch( const std::exception& e )
+            {
+                LBWARN << "prefetch failed: " << e.what() << std::endl;
+            }
+        });
+    }
+
+    /**
+     * Load the timesteps following the given one, then sample the given
+     * bricks for them within the memory budget.
+     */
+    void _prefetchTimeSteps( const uint32_t timeStep,
+                             const std::vector< livre::LODNode >& nodes,
+                             const livre::VolumeInformation& info ) const
+    {
+        const uint32_t endTimeStep = std::min( info.frameRange[1],
+                              uint32_t( timeStep + _prefetchFrames + 1 ));
+        for( uint32_t next = timeStep + 1; next < endTimeStep; ++next )
+        {
+            if( _stopPrefetch )
+                return;
+            lunchbox::ScopedWrite mutex( _loaderLock );
+            _getSnapshot( next );
+        }
+
+        const size_t size = _getBrickSize( info );
+        for( uint32_t next = timeStep + 1; next < endTimeStep; ++next )
+        {
+            for( const livre::LODNode& node : nodes )
+            {
+                if( _stopPrefetch )
+                    return;
+
+                const livre::NodeId& nodeId = node.getNodeId();
+                const livre::NodeId nextId( nodeId.getLevel(),
+                                            nodeId.getPosition(), next );
+                {
+                    lunchbox::ScopedWrite mutex( _prefetchLock );
+                    if( next < _timeStep ||
+                        _prefetchedSize + size > _prefetchBricksSize )
+                    {
+                        return;
+                    }
+                    if( _prefetchedBricks.count( nextId.getId( )))
+                        continue;
+                }
+
+                const livre::LODNode nextNode( nextId, node.getBlockSize(),
+                                               node.getWorldBox( ));
+                const livre::MemoryUnitPtr data = _sampleBrick( nextNode,
+                                                                info );
+                if( !data )
+                    continue;
+
+                lunchbox::ScopedWrite mutex( _prefetchLock );
+                if( next >= _timeStep &&
+                    _prefetchedBricks.emplace( nextId.getId(),
+                                        PrefetchedBrick{ next, data }).second )
+                {
+                    _prefetchedSize += size;
+                }
+            }
+        }
+    }
+
+    FloatBrickPtr _getFloatBrick( const livre::NodeId& nodeId ) const
+    {
+        lunchbox::ScopedWrite mutex( _floatBrickLock );
+        const auto i = _floatBrickIndex.find( nodeId.getId( ));
+        if( i == _floatBrickIndex.end( ))
+            return FloatBrickPtr();
+        _floatBricks.splice( _floatBricks.begin(), _floatBricks, i->second );
+        return i->second->second;
+    }
+
+    void _addFloatBrick( const livre::NodeId& nodeId, FloatBrick&& brick ) const
+    {
+        const size_t brickSize = brick.values.size() * sizeof( float );
+        const size_t maxSize = params.getDownsamplingCacheSize();
+        if( brickSize > maxSize )
+            return;
+
+        lunchbox::ScopedWrite mutex( _floatBrickLock );
+        const uint64_t id = nodeId.getId();
+        if( _floatBrickIndex.count( id ))
+            return;
+
+        _floatBricks.emplace_front( id, std::make_shared< const FloatBrick >(
+                                            std::move( brick )));
+        _floatBrickIndex[ id ] = _floatBricks.begin();
+        _floatBricksSize += brickSize;
+
+        while( _floatBricksSize > maxSize )
+        {
+            const auto& last = _floatBricks.back();
+            _floatBricksSize -= last.second->values.size() * sizeof( float );
+            _floatBrickIndex.erase( last.first );
+            _floatBricks.pop_back();
+        }
+    }
+
+    /**
+     * @return the values of the given brick downsampled from its eight
+     *         children, or nullptr if downsampling is disabled or not all
+     *         children were sampled accurately yet.
+     */
+    FloatBrickPtr _downsampleChildren( const livre::NodeId& nodeId,
+                                       const vmml::Vector3i& size ) const
+    {
+        if( _downsampling.empty( ))
+            return FloatBrickPtr();
+
+        FloatBricks children;
+        for( size_t i = 0; i < 8; ++i )
+        {
+            const vmml::Vector3ui octant( i & 1, ( i >> 1 ) & 1, i >> 2 );
+            const livre::NodeId childId( nodeId.getLevel() + 1,
+                                         nodeId.getPosition() * 2 + octant,
+                                         nodeId.getTimeStep( ));
+            children[i] = _getFloatBrick( childId );
+            if( !children[i] || !children[i]->accurate ||
+                children[i]->values.size() != size_t( size.product( )))
+            {
+                return FloatBrickPtr();
+            }
+        }
+
+        FloatBrick brick;
+        brick.values = _downsample( children, size,
+                                    _downsampling == "gaussian" );
+        brick.accurate = true;
+        _addFloatBrick( nodeId, FloatBrick( brick ));
+        return std::make_shared< const FloatBrick >( std::move( brick ));
+    }
+
+    /**
+     * @return the given values scaled like the sampled bricks. The window is
+     *         applied directly instead of through a ScaleFilter, which would
+     *         be set up and logged for every brick.
+     */
+    ByteVolume::Pointer _scale( const FloatBrick& brick,
+                                const ByteVolume::RegionType& region ) const
+    {
+        // window full data ranges like the sampling pipeline, from the
+        // statistics of the brick values
+        Vector2f range = params.getInputRange();
+        if( range == FULLDATARANGE )
+        {
+            const Vector2f& percentiles = params.getInputPercentiles();
+            VolumeStatistics statistics(
+                percentiles != Vector2f( 0.f, 100.f ));
+            for( const float value : brick.values )
+                statistics.add( value );
+
+            range[0] = statistics.getPercentile( percentiles[0] );
+            range[1] = statistics.getPercentile( percentiles[1] );
+        }
+        if( range[1] <= range[0] )
+            range[1] = range[0] + 1.f;
+        LBDEBUG << "Scale downsampled brick from values in [" << range[0]
+                << ", " << range[1] << "]" << std::endl;
+
+        ByteVolume::Pointer output = ByteVolume::New();
+        output->SetRegions( region );
+        output->Allocate();
+
+        // same mapping as itk::IntensityWindowingImageFilter
+        typedef ByteVolume::PixelType T;
+        const double minValue = std::numeric_limits< T >::min();
+        const double maxValue = std::numeric_limits< T >::max();
+        const double factor = ( maxValue - minValue ) / ( range[1] - range[0] );
+        const double offset = minValue - range[0] * factor;
+        T* voxels = output->GetBufferPointer();
+        for( size_t i = 0; i < brick.values.size(); ++i )
+        {
+            const double value = brick.values[i] * factor + offset;
+            voxels[i] = !( value > minValue ) ? T( minValue ) :
+                        value >= maxValue ? T( maxValue ) : T( value );
+        }
+        return output;
+    }
+
+    /**
+     * @return the part of the brick cache keys common to all bricks of this
+     *         volume: the URI, the Fivox version and the size and modification
+     *         time of the input files given in the URI and of the simulation
+     *         data read from the BlueConfig.
+     */
+    std::string _getCacheKey( const URI& uri ) const
+    {
+        std::ostringstream os;
+        os << uri << ", Fivox " << Version::getString();
+
+        std::vector< std::string > files = { params.getConfigPath(),
+                                             params.getSpikes(),
+                                             params.getReferenceVolume() };
+        switch( params.getType( ))
+        {
+        case VolumeType::compartments:
+        case VolumeType::somas:
+            files.push_back( params.getConfig().getReportSource(
+                                 params.getReport( )).getPath( ));
+            break;
+        case VolumeType::vsd:
+            files.push_back( params.getConfig().getReportSource(
+                                 params.getReport( )).getPath( ));
+            files.push_back( params.getAreas( ));
+            break;
+        case VolumeType::spikes:
+            if( params.getSpikes().empty( ))
+                files.push_back(
+                    params.getConfig().getSpikeSource().getPath( ));
+            break;
+        case VolumeType::synapses:
+        {
+            const std::string synapses =
+                params.getConfig().getSynapseSource().getPath();
+            files.push_back( synapses );
+            files.push_back( synapses + "/nrn_positions.h5" );
+            break;
+        }
+        default:
+            break;
+        }
+
+        for( const std::string& file : files )
+        {
+            struct stat info;
+            if( !file.empty() && ::stat( file.c_str(), &info ) == 0 )
+            {
+                os << ", " << file << " " << info.st_size << " "
+                   << info.st_mtime;
+            }
+        }
+        return os.str();
+    }
+
+    ByteVolume::Pointer _sample( Pipeline& pipeline, EventSourcePtr events,
+                                 const ByteVolume::RegionType& region,
+                                 const ByteVolume::SpacingType& spacing,
+                                 const ByteVolume::PointType& origin ) const
+    {
+        ByteVolume::Pointer output;
+        if( pipeline.byteSource )
+        {
+            auto byteSource = pipeline.byteSource;
+            output = byteSource->GetOutput();
+            output->SetRegions( region );
+            output->SetSpacing( spacing );
+            output->SetOrigin( origin );
+
+            byteSource->setEventSource( events );
+            byteSource->Modified();
+            byteSource->Update();
+        }
+        else
+        {
+            auto floatSource = pipeline.source;
+            auto volume = floatSource->GetOutput();
+            volume->SetRegions( region );
+            volume->SetSpacing( spacing );
+            volume->SetOrigin( origin );
+
+            floatSource->setEventSource( events );
+            floatSource->Modified();
+            pipeline.scaler->Update();
+            output = pipeline.scaler->GetOutput();
+        }
+
+        // hand the buffer over to Livre, the next update allocates a new one
+        output->DisconnectPipeline();
+        return output;
+    }
+
+    PipelinePtr _newPipeline() const
+    {
+        PipelinePtr pipeline( new Pipeline );
+        // downsampling needs the values before scaling
+        if( _downsampling.empty( ))
+        {
+            pipeline->byteSource =
+                params.newScaledImageSource< ByteVolume >( loader );
+            if( pipeline->byteSource )
+                return pipeline;
+        }
+
+        // fall back to sampling floats and scaling them afterwards
+        pipeline->source = params.newImageSource< FloatVolume >( loader );
+        pipeline->scaler.reset( new ScaleFilter< ByteVolume >(
+                                    pipeline->source, params.getInputRange(),
+                                    params.getInputPercentiles( )));
+        return pipeline;
+    }
+
+    PipelinePtr _acquirePipeline() const
+    {
+        {
+            lunchbox::ScopedWrite mutex( _pipelineLock );
+            if( !_pipelines.empty( ))
+            {
+                PipelinePtr pipeline = std::move( _pipelines.back( ));
+                _pipelines.pop_back();
+                return pipeline;
+            }
+        }
+        return _newPipeline();
+    }
+
+    void _releasePipeline( PipelinePtr pipeline ) const
+    {
+        lunchbox::ScopedWrite mutex( _pipelineLock );
+        _pipelines.push_back( std::move( pipeline ));
+    }
+
+    /**
+     * @return the events to sample a brick of the given timestep and level,
+     *         loaded once by the shared loader and then sampled concurrently
+     *         by all threads. Coarse levels use proxy events aggregated in
+     *         cells of the voxel spacing, if enabled.
+     */
+    EventSourcePtr _getEvents( const uint32_t timeStep,
+                               const int32_t levelFromBottom,
+                               const float spacing ) const
+    {
+        lunchbox::ScopedWrite mutex( _loaderLock );
+        Snapshot& snapshot = _getSnapshot( timeStep );
+        if( levelFromBottom <= 0 || !_useProxies( ))
+            return snapshot.events;
+
+        EventSourcePtr& proxies = snapshot.proxies[ levelFromBottom ];
+        if( !proxies )
+        {
+            proxies = snapshot.events->createProxies( spacing );
+            LBINFO << "Aggregated " << snapshot.events->getNumEvents()
+                   << " events into " << proxies->getNumEvents()
+                   << " proxies for level " << levelFromBottom
+                   << " of timestep " << timeStep << std::endl;
+        }
+        return proxies;
+    }
+
+    Snapshot& _getSnapshot( const uint32_t timeStep ) const
+    {
+        for( Snapshot& snapshot : _snapshots )
+            if( snapshot.timeStep == timeStep )
+                return snapshot;
+
+        loader->setTime( timeStep );
+        if( loader->load() < 0 )
+        {
+            LBERROR << "Timestep " << timeStep << " not loaded, no data or "
+                    << "events" << std::endl;
+        }
+
+        _snapshots.push_back( Snapshot{ timeStep, loader->createSnapshot(),
+                                        {} });
+        if( _snapshots.size() > _maxSnapshots + _prefetchFrames )
+            _snapshots.pop_front();
+        return _snapshots.back();
+    }
+
+    // proxies only approximate functors evaluating all events with a distance
+    // falloff; the others look up the events in the voxel already
+    bool _useProxies() const
+    {
+        if( !params.useEventLOD( ))
+            return false;
+
+        switch( params.getFunctorType( ))
+        {
+        case FunctorType::field:
+        case FunctorType::lfp:
+            return true;
+        default:
+            return false;
+        }
+    }
 };
 
 DataSource::DataSource( const livre::DataSourcePluginData& pluginData )
@@ -0,0 +1,98 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FIVOX_QUANTIZEFUNCTOR_H
+#define FIVOX_QUANTIZEFUNCTOR_H
+
+#include <fivox/api.h>
+#include <fivox/eventFunctor.h> // base class
+
+#include <limits>
+
+namespace fivox
+{
+/**
+ * Samples events using a floating point functor, and windows and quantizes
+ * each sample into the pixel type of the image.
+ *
+ * The mapping is the same as the one of itk::IntensityWindowingImageFilter
+ * used by ScaleFilter, but applied while sampling, so no intermediate floating
+ * point volume is needed.
+ */
+template< typename TImage >
+class QuantizeFunctor : public EventFunctor< TImage >
+{
+    typedef EventFunctor< TImage > Super;
+    typedef typename Super::TPixel TPixel;
+    typedef typename Super::TPoint TPoint;
+    typedef typename Super::TSpacing TSpacing;
+
+public:
+    /**
+     * @param functor the functor sampling the floating point values
+     * @param inputRange the range of the input values mapped to the full range
+     *                   of the pixel type; values outside are clamped
+     */
+    FIVOX_API QuantizeFunctor( EventFunctorPtr< FloatVolume > functor,
+                               const Vector2f& inputRange )
+        : Super()
+        , _functor( functor )
+        , _windowMin( inputRange[0] )
+        , _windowMax( inputRange[1] )
+        , _scale(( double( _outputMax ) - double( _outputMin )) /
+                 ( double( _windowMax ) - double( _windowMin )))
+        , _shift( double( _outputMin ) - double( _windowMin ) * _scale )
+    {}
+    FIVOX_API virtual ~QuantizeFunctor() {}
+
+    FIVOX_API void beforeGenerate() override
+    {
+        _functor->setEventSource( Super::_source );
+        _functor->beforeGenerate();
+    }
+
+    FIVOX_API TPixel operator()( const TPoint& point, const TSpacing& spacing )
+        const override;
+
+private:
+    static constexpr TPixel _outputMin = std::numeric_limits< TPixel >::min();
+    static constexpr TPixel _outputMax = std::numeric_limits< TPixel >::max();
+
+    EventFunctorPtr< FloatVolume > _functor;
+    const float _windowMin;
+    const float _windowMax;
+    const double _scale;
+    const double _shift;
+};
+
+template< class TImage > inline typename QuantizeFunctor< TImage >::TPixel
+QuantizeFunctor< TImage >::operator()( const TPoint& point,
+                                       const TSpacing& spacing ) const
+{
+    const float value = (*_functor)( point, spacing );
+    if( value < _windowMin )
+        return _outputMin;
+    if( value > _windowMax )
+        return _outputMax;
+    return static_cast< TPixel >( value * _scale + _shift );
+}
+
+}
+
+#endif
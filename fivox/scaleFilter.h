@@ -21,6 +21,8 @@
 #define FIVOX_SCALEFILTER_H
 
 #include <fivox/api.h>
+#include <fivox/imageSource.h>
+#include <fivox/volumeStatistics.h>
 #include <itkIntensityWindowingImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
 
@@ -80,6 +82,48 @@ public:
         _scaler->SetOutputMaximum( std::numeric_limits< T >::max( ));
     }
 
+    /**
+     * ScaleFilter constructor that scales the output of an image source.
+     *
+     * For a FULLDATARANGE input range, the window is computed on Update() from
+     * the statistics gathered by the source while generating the volume,
+     * which avoids the extra pass over the volume of a full rescale. The
+     * percentiles select the window from the value histogram, enabled on the
+     * source if needed.
+     *
+     * @param source the image source producing the floating point volume
+     * @param dataRange the lower and upper limits for the input data range
+     * @param percentiles the lower and upper percentiles in [0, 100] of the
+     *                    voxel values used as window for FULLDATARANGE
+     */
+    FIVOX_API ScaleFilter( ImageSourcePtr< fivox::FloatVolume > source,
+                           const fivox::Vector2f& dataRange,
+                           const fivox::Vector2f& percentiles =
+                               fivox::Vector2f( 0.f, 100.f ))
+    {
+        if( dataRange != fivox::FULLDATARANGE )
+        {
+            *this = ScaleFilter( source->GetOutput(), dataRange );
+            return;
+        }
+
+        LBINFO << "Scale volume into ["
+               << size_t(std::numeric_limits< T >::min( )) << ", "
+               << size_t(std::numeric_limits< T >::max( ))
+               << "] from percentiles [" << percentiles[0] << ", "
+               << percentiles[1] << "] of the data range" << std::endl;
+
+        _scaler = IntensityWindowingImageFilter::New();
+        _scaler->SetInput( source->GetOutput( ));
+        _scaler->SetOutputMinimum( std::numeric_limits< T >::min( ));
+        _scaler->SetOutputMaximum( std::numeric_limits< T >::max( ));
+
+        _source = source;
+        _percentiles = percentiles;
+        if( _percentiles != fivox::Vector2f( 0.f, 100.f ))
+            _source->setHistogramEnabled( true );
+    }
+
     FIVOX_API typename TImage::Pointer GetOutput()
     {
         return _scaler ? _scaler->GetOutput() : _rescale->GetOutput();
@@ -87,6 +131,9 @@ public:
 
     FIVOX_API void Update()
     {
+        if( _source )
+            _updateWindow();
+
         if( _scaler )
             _scaler->Update();
         else
@@ -96,6 +143,25 @@ public:
 private:
     typename IntensityWindowingImageFilter::Pointer _scaler;
     typename RescaleFilter::Pointer _rescale;
+
+    ImageSourcePtr< fivox::FloatVolume > _source;
+    fivox::Vector2f _percentiles;
+
+    void _updateWindow()
+    {
+        _source->Update();
+        const VolumeStatistics& statistics = _source->getStatistics();
+        float minValue = statistics.getPercentile( _percentiles[0] );
+        float maxValue = statistics.getPercentile( _percentiles[1] );
+        if( maxValue <= minValue )
+            maxValue = minValue + 1.f;
+
+        LBINFO << "Scale volume from values in [" << minValue << ", "
+               << maxValue << "] of data range [" << statistics.getMin()
+               << ", " << statistics.getMax() << "]" << std::endl;
+        _scaler->SetWindowMinimum( minValue );
+        _scaler->SetWindowMaximum( maxValue );
+    }
 };
 
 } // namespace fivox
@@ -43,37 +43,36 @@ public:
         : _output( output )
         , _report( params.getConfig().getReportSource( params.getReport( )),
                    brion::MODE_READ, params.getGIDs( ))
+        , _frameLoader( _report )
     {
-        const brain::Circuit circuit( params.getConfig( ));
-        const auto morphologies = circuit.loadMorphologies(
-            params.getGIDs(), brain::Circuit::Coordinates::global );
-
         // add soma events only
-        helpers::addCompartmentEvents( morphologies, _report, output, true );
+        helpers::loadCompartmentEvents( params, _report, output, true );
+
+        // This code assumes that section 0 is the soma.
+        const brion::SectionOffsets& offsets = _report.getOffsets();
+        _somaOffsets.reserve( offsets.size( ));
+        for( const auto& cellOffsets : offsets )
+            _somaOffsets.push_back( cellOffsets[0] );
     }
 
     ssize_t load()
     {
-        const brion::floatsPtr frame =
-                _report.loadFrame( _output.getCurrentTime( ));
+        const brion::floatsPtr frame = _frameLoader.load( _output );
         if( !frame )
             return -1;
 
-        const brion::GIDSet& gids = _report.getGIDs();
-        const brion::SectionOffsets& offsets = _report.getOffsets();
-        const std::vector< float > reportValues = *frame;
-
-        for( size_t i = 0; i < gids.size(); ++i )
-        {
-            // This code assumes that section 0 is the soma.
-            const float v = reportValues[offsets[i][0]];
-            _output[i] = v;
-        }
-        return gids.size();
+        // gather the soma values straight from the frame
+        const float* __restrict__ values = frame->data();
+        float* __restrict__ somaValues = &_output[0];
+        for( size_t i = 0; i < _somaOffsets.size(); ++i )
+            somaValues[i] = values[ _somaOffsets[i] ];
+        return _somaOffsets.size();
     }
 
     EventSource& _output;
     brion::CompartmentReport _report;
+    helpers::FrameLoader _frameLoader;
+    std::vector< uint64_t > _somaOffsets; // in the frame, per cell
 };
 
 SomaLoader::SomaLoader( const URIHandler& params )
@@ -0,0 +1,296 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "spikeIndex.h"
+
+#include <brain/spikeReportReader.h>
+
+#include <lunchbox/debug.h>
+#include <lunchbox/log.h>
+#include <lunchbox/memoryMap.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fivox
+{
+namespace
+{
+const std::string _extension( ".fivoxindex" );
+const uint32_t _magic = 0xf5b1;
+const uint32_t _version = 1;
+const size_t _spikesPerBin = 64; // on average
+
+/** Header of the index, followed by the bin offsets, times and GIDs. */
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t reportSize;
+    int64_t reportTime;
+    uint64_t numSpikes;
+    uint64_t numBins;
+    float startTime;
+    float binSize;
+    float endTime;
+    uint32_t padding;
+};
+
+size_t _getSize( const uint64_t numSpikes, const uint64_t numBins )
+{
+    return sizeof( Header ) + ( numBins + 1 ) * sizeof( uint64_t ) +
+           numSpikes * ( sizeof( float ) + sizeof( uint32_t ));
+}
+}
+
+class SpikeIndex::Impl
+{
+public:
+    explicit Impl( const URI& uri )
+        : header( nullptr )
+    {
+        const std::string& report = uri.getPath();
+        struct stat info;
+        if(( !uri.getScheme().empty() && uri.getScheme() != "file" ) ||
+           report.empty() || ::stat( report.c_str(), &info ) != 0 ||
+           !S_ISREG( info.st_mode ))
+        {
+            LBTHROW( std::runtime_error( "Spike report '" + report +
+                                         "' is not a file" ));
+        }
+
+        const std::string filename = report + _extension;
+        if( _map( filename, info ))
+        {
+            LBINFO << "Using spike index " << filename << " with "
+                   << header->numSpikes << " spikes" << std::endl;
+            return;
+        }
+
+        _build( uri, info );
+        _save( filename );
+    }
+
+    std::pair< size_t, size_t > find( const float start,
+                                      const float end ) const
+    {
+        const float* first = _lowerBound( start );
+        const float* last = std::max( first, _lowerBound( end ));
+        return std::make_pair( first - times, last - times );
+    }
+
+    const Header* header;
+    const uint64_t* offsets;
+    const float* times;
+    const uint32_t* gids;
+
+private:
+    lunchbox::MemoryMap _file;
+    std::vector< uint64_t > _data; // if not mapped from _file
+
+    size_t _getBin( const float time ) const
+    {
+        const float bin = ( time - header->startTime ) / header->binSize;
+        if( !( bin > 0.f ))
+            return 0;
+        if( bin >= float( header->numBins - 1 ))
+            return header->numBins - 1;
+        return size_t( bin );
+    }
+
+    // first spike at or after the given time
+    const float* _lowerBound( const float time ) const
+    {
+        const size_t bin = _getBin( time );
+        return std::lower_bound( times + offsets[ bin ],
+                                 times + offsets[ bin + 1 ], time );
+    }
+
+    void _setData( const void* data )
+    {
+        header = static_cast< const Header* >( data );
+        offsets = reinterpret_cast< const uint64_t* >( header + 1 );
+        times = reinterpret_cast< const float* >(
+            offsets + header->numBins + 1 );
+        gids = reinterpret_cast< const uint32_t* >(
+            times + header->numSpikes );
+    }
+
+    // @return true if a valid index of the given report was mapped
+    bool _map( const std::string& filename, const struct stat& info )
+    {
+        struct stat indexInfo;
+        if( ::stat( filename.c_str(), &indexInfo ) != 0 ||
+            size_t( indexInfo.st_size ) < sizeof( Header ))
+        {
+            return false;
+        }
+
+        const Header* fileHeader =
+            static_cast< const Header* >( _file.map( filename ));
+        if( !fileHeader || fileHeader->magic != _magic ||
+            fileHeader->version != _version ||
+            fileHeader->reportSize != uint64_t( info.st_size ) ||
+            fileHeader->reportTime != int64_t( info.st_mtime ) ||
+            fileHeader->numBins == 0 ||
+            _file.getSize() != _getSize( fileHeader->numSpikes,
+                                         fileHeader->numBins ))
+        {
+            LBINFO << "Rebuilding outdated spike index " << filename
+                   << std::endl;
+            _file.unmap();
+            return false;
+        }
+
+        _setData( fileHeader );
+        return true;
+    }
+
+    void _build( const URI& uri, const struct stat& info )
+    {
+        LBINFO << "Building spike index for " << uri.getPath() << std::endl;
+        brain::SpikeReportReader reader( uri );
+        if( !reader.hasEnded( ))
+            LBTHROW( std::runtime_error( "Spike report is not complete" ));
+
+        const float endTime = reader.getEndTime();
+        brain::Spikes spikes = reader.getSpikes(
+            std::numeric_limits< float >::lowest(),
+            std::nextafter( endTime, std::numeric_limits< float >::max( )));
+        std::stable_sort( spikes.begin(), spikes.end(),
+                          []( const brain::Spike& a, const brain::Spike& b )
+                              { return a.first < b.first; });
+
+        const size_t numSpikes = spikes.size();
+        const size_t numBins = std::max( numSpikes / _spikesPerBin,
+                                         size_t( 1 ));
+        Header fileHeader;
+        ::memset( &fileHeader, 0, sizeof( fileHeader ));
+        fileHeader.magic = _magic;
+        fileHeader.version = _version;
+        fileHeader.reportSize = info.st_size;
+        fileHeader.reportTime = info.st_mtime;
+        fileHeader.numSpikes = numSpikes;
+        fileHeader.numBins = numBins;
+        fileHeader.startTime = spikes.empty() ? 0.f : spikes.front().first;
+        fileHeader.binSize = spikes.empty() ? 1.f :
+                            ( spikes.back().first - spikes.front().first ) /
+                            float( numBins );
+        if( !( fileHeader.binSize > 0.f ))
+            fileHeader.binSize = 1.f;
+        fileHeader.endTime = endTime;
+
+        const size_t size = _getSize( numSpikes, numBins );
+        _data.resize(( size + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ));
+        ::memcpy( _data.data(), &fileHeader, sizeof( fileHeader ));
+        _setData( _data.data( ));
+
+        uint64_t* binOffsets = const_cast< uint64_t* >( offsets );
+        float* spikeTimes = const_cast< float* >( times );
+        uint32_t* spikeGIDs = const_cast< uint32_t* >( gids );
+        size_t bin = 0;
+        for( size_t i = 0; i < numSpikes; ++i )
+        {
+            spikeTimes[i] = spikes[i].first;
+            spikeGIDs[i] = spikes[i].second;
+
+            // the first spike of each bin up to the bin of this spike
+            const size_t spikeBin = _getBin( spikes[i].first );
+            while( bin <= spikeBin )
+                binOffsets[ bin++ ] = i;
+        }
+        while( bin <= numBins )
+            binOffsets[ bin++ ] = numSpikes;
+    }
+
+    // save the built index, the report directory may not be writable
+    void _save( const std::string& filename ) const
+    {
+        const size_t size = _getSize( header->numSpikes, header->numBins );
+        // unique per process, as processes may index the same report
+        std::ostringstream tmpName;
+        tmpName << filename << "." << ::getpid() << ".tmp";
+        {
+            lunchbox::MemoryMap file;
+            void* data = file.create( tmpName.str(), size );
+            if( !data )
+            {
+                LBINFO << "Cannot save spike index " << filename
+                       << ", keeping it in memory" << std::endl;
+                return;
+            }
+            ::memcpy( data, header, size );
+        }
+
+        if( ::rename( tmpName.str().c_str(), filename.c_str( )) != 0 )
+        {
+            LBWARN << "Cannot save spike index " << filename << ": "
+                   << ::strerror( errno ) << std::endl;
+            ::unlink( tmpName.str().c_str( ));
+            return;
+        }
+        LBINFO << "Saved spike index " << filename << " with "
+               << header->numSpikes << " spikes" << std::endl;
+    }
+};
+
+SpikeIndex::SpikeIndex( const URI& uri )
+    : _impl( new SpikeIndex::Impl( uri ))
+{}
+
+SpikeIndex::~SpikeIndex()
+{}
+
+size_t SpikeIndex::getNumSpikes() const
+{
+    return _impl->header->numSpikes;
+}
+
+float SpikeIndex::getEndTime() const
+{
+    return _impl->header->endTime;
+}
+
+const float* SpikeIndex::getTimes() const
+{
+    return _impl->times;
+}
+
+const uint32_t* SpikeIndex::getGIDs() const
+{
+    return _impl->gids;
+}
+
+std::pair< size_t, size_t > SpikeIndex::find( const float start,
+                                              const float end ) const
+{
+    return _impl->find( start, end );
+}
+
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FIVOX_SPIKEINDEX_H
+#define FIVOX_SPIKEINDEX_H
+
+#include <fivox/api.h>
+#include <fivox/types.h>
+
+#include <memory>
+#include <utility>
+
+namespace fivox
+{
+
+/**
+ * Time-sorted index of all spikes of a spike report file.
+ *
+ * The index is built from the report when it is first opened and saved next
+ * to it, with the extension ".fivoxindex". Later sessions memory-map the saved
+ * index, as long as the report is not modified. The spikes are grouped in
+ * time bins, so finding the spikes of a time window costs two binary searches
+ * within one bin each.
+ */
+class SpikeIndex
+{
+public:
+    /**
+     * Open the index of the given spike report, building it if needed.
+     *
+     * @param uri the spike report, which has to be a complete file
+     * @throw std::runtime_error if the report is not a file or can not be read
+     */
+    FIVOX_API explicit SpikeIndex( const URI& uri );
+    FIVOX_API ~SpikeIndex();
+
+    /** @return the number of indexed spikes. */
+    FIVOX_API size_t getNumSpikes() const;
+
+    /** @return the end time of the spike report in milliseconds. */
+    FIVOX_API float getEndTime() const;
+
+    /** @return the time-sorted spike times in milliseconds. */
+    FIVOX_API const float* getTimes() const;
+
+    /** @return the GIDs of the time-sorted spikes. */
+    FIVOX_API const uint32_t* getGIDs() const;
+
+    /**
+     * @return the indices [first, last) of the spikes in the time window
+     *         [start, end).
+     */
+    FIVOX_API std::pair< size_t, size_t > find( float start, float end ) const;
+
+private:
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+}
+
+#endif
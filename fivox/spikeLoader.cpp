@@ -20,45 +20,68 @@
  */
 
 #include "spikeLoader.h"
+#include "spikeIndex.h"
 #include "uriHandler.h"
 
 #include <brain/brain.h>
 #include <brion/brion.h>
 
-#include <lunchbox/os.h>
+#include <algorithm>
+#include <limits>
 
 using boost::lexical_cast;
 
 namespace fivox
 {
+namespace
+{
+// index of GIDs which are not in the target
+const size_t _invalidIndex = std::numeric_limits< size_t >::max();
+}
+
 class SpikeLoader::Impl
 {
 public:
     Impl( EventSource& output, const URIHandler& params )
         : _output( output )
         , _spikesStart( 0.f )
+        , _numSpiking( 0 )
+        , _numSpikes( 0 )
+        , _hasWindow( false )
+        , _windowStart( 0.f )
+        , _windowEnd( 0.f )
     {
         const brion::GIDSet& gids = params.getGIDs();
 
         const brain::Circuit circuit( params.getConfig( ));
         const brion::Vector3fs& positions = circuit.getPositions( gids );
 
-        size_t i = 0;
         _output.resize( gids.size( ));
         _spikesPerNeuron.resize( gids.size( ));
-        _gidIndex.resize( *gids.rbegin() + 1 );
-        for( const uint32_t gid: gids )
-        {
+        _gids.assign( gids.begin(), gids.end( ));
+        _contiguousGIDs = _gids.back() - _gids.front() + 1 == _gids.size();
+        for( size_t i = 0; i < gids.size(); ++i )
             _output.update( i, positions[i], /*radius*/ 0.f );
-            _gidIndex[gid] = i++;
-        }
 
         const std::string& spikePath = params.getSpikes();
-        _report.reset(
-            new brain::SpikeReportReader( spikePath.empty()
-                                          ? params.getConfig().getSpikeSource()
-                                          : URI( spikePath ),
-                                          gids ));
+        const URI uri = spikePath.empty() ? params.getConfig().getSpikeSource()
+                                          : URI( spikePath );
+
+        // complete report files are read through an index of all spikes,
+        // streams and other reports through the report reader
+        try
+        {
+            _index.reset( new SpikeIndex( uri ));
+            _spikesEnd = _index->getEndTime();
+            return;
+        }
+        catch( const std::runtime_error& e )
+        {
+            LBINFO << "Reading spikes without index: " << e.what()
+                   << std::endl;
+        }
+
+        _report.reset( new brain::SpikeReportReader( uri, gids ));
         _spikesEnd = _report->getEndTime();
     }
 
@@ -78,48 +101,159 @@ public:
         _spikesEnd = _report->getEndTime();
     }
 
-    ssize_t load()
+    ssize_t load( const bool valuesRestored )
     {
         const float start = _output.getCurrentTime();
-        lunchbox::setZero( _spikesPerNeuron.data(),
-                           _spikesPerNeuron.size() * sizeof(size_t));
-
         const float end = start + _output.getDuration();
-        const size_t numSpikes = _loadSpikes( start, end );
+        _changed.clear();
+
+        // slide the window of the previous load if the new one overlaps it,
+        // e.g. for a duration larger than dt
+        if( !valuesRestored && _hasWindow && start >= _windowStart &&
+            start <= _windowEnd && end >= _windowEnd )
+        {
+            _forEachSpike( _windowStart, start, [this]( const size_t index )
+                { _removeSpike( index ); });
+            _forEachSpike( _windowEnd, end, [this]( const size_t index )
+                { _addSpike( index ); });
 
-        for( size_t i = 0; i < _spikesPerNeuron.size(); ++i )
-            _output[i] = _spikesPerNeuron[i];
+            for( const size_t i : _changed )
+                _output[i] = _spikesPerNeuron[i];
+            _compactSpiking();
+        }
+        else
+        {
+            // only reset the neurons which spiked in the previous window,
+            // unless the values of another frame were restored since then
+            if( valuesRestored )
+            {
+                for( size_t i = 0; i < _spikesPerNeuron.size(); ++i )
+                    _output[i] = 0.f;
+            }
+            else
+            {
+                for( const size_t i : _spiking )
+                    _output[i] = 0.f;
+            }
+            for( const size_t i : _spiking )
+                _spikesPerNeuron[i] = 0;
+            _spiking.clear();
+            _numSpiking = 0;
+            _numSpikes = 0;
 
-        return numSpikes;
+            _forEachSpike( start, end, [this]( const size_t index )
+                { _addSpike( index ); });
+            for( const size_t i : _spiking )
+                _output[i] = _spikesPerNeuron[i];
+        }
+
+        _hasWindow = true;
+        _windowStart = start;
+        _windowEnd = end;
+        return _numSpikes;
     }
 
+    // @return the index of the given GID, _invalidIndex if not in the target
+    size_t _getIndex( const uint32_t gid ) const
+    {
+        if( _contiguousGIDs )
+        {
+            return gid >= _gids.front() && gid <= _gids.back() ?
+                       gid - _gids.front() : _invalidIndex;
+        }
 
-    size_t _loadSpikes( const float start, const float end )
+        const auto i = std::lower_bound( _gids.begin(), _gids.end(), gid );
+        return i != _gids.end() && *i == gid ? i - _gids.begin()
+                                             : _invalidIndex;
+    }
+
+    void _addSpike( const size_t index )
     {
-        size_t numSpikes = 0;
-        for( const auto& spike : _report->getSpikes( start, end ))
+        if( _spikesPerNeuron[index]++ == 0 )
+        {
+            _spiking.push_back( index );
+            ++_numSpiking;
+        }
+        _changed.push_back( index );
+        ++_numSpikes;
+    }
+
+    void _removeSpike( const size_t index )
+    {
+        if( --_spikesPerNeuron[index] == 0 )
+            --_numSpiking;
+        _changed.push_back( index );
+        --_numSpikes;
+    }
+
+    // remove the neurons which stopped spiking while sliding the window
+    void _compactSpiking()
+    {
+        if( _spiking.size() < 2 * _numSpiking + 1024 )
+            return;
+
+        std::sort( _spiking.begin(), _spiking.end( ));
+        _spiking.erase( std::unique( _spiking.begin(), _spiking.end( )),
+                        _spiking.end( ));
+        _spiking.erase( std::remove_if( _spiking.begin(), _spiking.end(),
+                                        [this]( const size_t i )
+                                        { return _spikesPerNeuron[i] == 0; }),
+                        _spiking.end( ));
+    }
+
+    /** Call the given function for the index of all spikes in [start, end). */
+    template< class F >
+    void _forEachSpike( const float start, const float end, const F& func )
+    {
+        if( end <= start )
+            return;
+
+        if( _index )
         {
-            ++_spikesPerNeuron[_gidIndex[spike.second]];
-            ++numSpikes;
+            // the index contains the spikes of all GIDs
+            const auto range = _index->find( start, end );
+            const uint32_t* gids = _index->getGIDs();
+            for( size_t i = range.first; i < range.second; ++i )
+            {
+                const size_t index = _getIndex( gids[i] );
+                if( index != _invalidIndex )
+                    func( index );
+            }
+            return;
         }
 
-        return numSpikes;
+        for( const auto& spike : _report->getSpikes( start, end ))
+        {
+            const size_t index = _getIndex( spike.second );
+            if( index != _invalidIndex )
+                func( index );
+        }
     }
 
     EventSource& _output;
     float _spikesStart;
     float _spikesEnd;
 
-    // maps GID to its index in the target
-    // OPT: no (unordered)map because of constant lookup but 'wastes' memory
-    // (container.size() is number of GIDs)
-    brion::size_ts _gidIndex;
+    // the sorted GIDs of the target, the event index of a GID is its index in
+    // this vector, i.e. its offset to the first GID if they are contiguous
+    brion::uint32_ts _gids;
+    bool _contiguousGIDs;
 
     // aggregates spikes for each neuron in interval
-    // OPT: no (unordered)map because of constant lookup but 'wastes' memory
-    // (container.size() is number of GIDs)
-    brion::size_ts _spikesPerNeuron;
+    brion::uint32_ts _spikesPerNeuron;
+    // neurons with spikes in the interval, may contain duplicates and neurons
+    // without spikes anymore after sliding the interval
+    brion::size_ts _spiking;
+    size_t _numSpiking; // neurons with spikes in the interval
+    size_t _numSpikes; // in the interval
+    brion::size_ts _changed; // neurons updated while sliding the interval
+
+    // the interval of the last load
+    bool _hasWindow;
+    float _windowStart;
+    float _windowEnd;
 
+    std::unique_ptr< SpikeIndex > _index; // null if reading from _report
     std::unique_ptr< brain::SpikeReportReader > _report;
 };
 
@@ -143,7 +277,7 @@ Vector2f SpikeLoader::_getTimeRange() const
 ssize_t SpikeLoader::_load( const size_t /*chunkIndex*/,
                             const size_t /*numChunks*/ )
 {
-    return _impl->load();
+    return _impl->load( _valuesRestored( ));
 }
 
 }
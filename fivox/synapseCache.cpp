@@ -0,0 +1,245 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "synapseCache.h"
+
+#include <brain/synapses.h>
+#include <brain/synapsesStream.h>
+
+#include <lunchbox/debug.h>
+#include <lunchbox/log.h>
+#include <lunchbox/memoryMap.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fivox
+{
+namespace
+{
+const std::string _extension( ".fivoxsynapses" );
+const uint32_t _magic = 0xf5b2;
+const uint32_t _version = 1;
+const size_t _gidsPerRead = 256;
+
+/** Header of the cache file, followed by the x, y and z coordinates. */
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t keyHigh;
+    uint64_t keyLow;
+    uint64_t numSynapses;
+};
+
+size_t _getSize( const uint64_t numSynapses )
+{
+    return sizeof( Header ) + 3 * numSynapses * sizeof( float );
+}
+}
+
+class SynapseCache::Impl
+{
+public:
+    Impl( const std::string& directory, const servus::uint128_t& key,
+          const StreamFactory& newStream )
+        : header( nullptr )
+    {
+        if( ::mkdir( directory.c_str(), 0755 ) != 0 && errno != EEXIST )
+        {
+            LBTHROW( std::runtime_error( "Cannot create synapse cache " +
+                                         directory + ": " +
+                                         ::strerror( errno )));
+        }
+
+        std::ostringstream os;
+        os << directory << "/" << std::hex << std::setfill( '0' )
+           << std::setw( 16 ) << key.high() << std::setw( 16 ) << key.low()
+           << _extension;
+        const std::string filename = os.str();
+        if( _map( filename, key ))
+        {
+            LBINFO << "Using synapse cache " << filename << " with "
+                   << header->numSynapses << " synapses" << std::endl;
+            return;
+        }
+
+        _build( key, newStream );
+        if( _save( filename ) && _map( filename, key ))
+        {
+            // release the read positions, the saved ones are mapped
+            for( std::vector< float >& column : _positions )
+                std::vector< float >().swap( column );
+        }
+    }
+
+    const Header* header;
+    const float* posX;
+    const float* posY;
+    const float* posZ;
+
+private:
+    lunchbox::MemoryMap _file;
+    Header _header; // if not mapped from _file
+    std::vector< float > _positions[3]; // if not mapped from _file
+
+    void _setData( const void* data )
+    {
+        header = static_cast< const Header* >( data );
+        posX = reinterpret_cast< const float* >( header + 1 );
+        posY = posX + header->numSynapses;
+        posZ = posY + header->numSynapses;
+    }
+
+    // @return true if the positions of the given key were mapped
+    bool _map( const std::string& filename, const servus::uint128_t& key )
+    {
+        struct stat info;
+        if( ::stat( filename.c_str(), &info ) != 0 ||
+            size_t( info.st_size ) < sizeof( Header ))
+        {
+            return false;
+        }
+
+        const Header* fileHeader =
+            static_cast< const Header* >( _file.map( filename ));
+        if( !fileHeader || fileHeader->magic != _magic ||
+            fileHeader->version != _version ||
+            fileHeader->keyHigh != key.high() ||
+            fileHeader->keyLow != key.low() ||
+            _file.getSize() != _getSize( fileHeader->numSynapses ))
+        {
+            LBINFO << "Rebuilding invalid synapse cache " << filename
+                   << std::endl;
+            _file.unmap();
+            return false;
+        }
+
+        _setData( fileHeader );
+        return true;
+    }
+
+    // read the positions into _positions, which are used until mapped
+    void _build( const servus::uint128_t& key, const StreamFactory& newStream )
+    {
+        LBINFO << "Reading synapse positions to cache them" << std::endl;
+        brain::SynapsesStream stream = newStream();
+        while( !stream.eos( ))
+        {
+            const brain::Synapses synapses = stream.read( _gidsPerRead ).get();
+            const float* coordinates[] = { synapses.preSurfaceXPositions(),
+                                           synapses.preSurfaceYPositions(),
+                                           synapses.preSurfaceZPositions() };
+            for( size_t i = 0; i < 3; ++i )
+                _positions[i].insert( _positions[i].end(), coordinates[i],
+                                      coordinates[i] + synapses.size( ));
+        }
+
+        ::memset( &_header, 0, sizeof( _header ));
+        _header.magic = _magic;
+        _header.version = _version;
+        _header.keyHigh = key.high();
+        _header.keyLow = key.low();
+        _header.numSynapses = _positions[0].size();
+
+        header = &_header;
+        posX = _positions[0].data();
+        posY = _positions[1].data();
+        posZ = _positions[2].data();
+    }
+
+    // @return true if the read positions were saved to the given file
+    bool _save( const std::string& filename ) const
+    {
+        // unique per process, as processes may share the cache directory
+        std::ostringstream tmpName;
+        tmpName << filename << "." << ::getpid() << ".tmp";
+        {
+            lunchbox::MemoryMap file;
+            uint8_t* data = static_cast< uint8_t* >(
+                file.create( tmpName.str(), _getSize( header->numSynapses )));
+            if( !data )
+            {
+                LBINFO << "Cannot save synapse cache " << filename
+                       << ", keeping it in memory" << std::endl;
+                return false;
+            }
+
+            ::memcpy( data, header, sizeof( Header ));
+            data += sizeof( Header );
+            const size_t bytes = header->numSynapses * sizeof( float );
+            for( const std::vector< float >& column : _positions )
+            {
+                if( bytes > 0 )
+                    ::memcpy( data, column.data(), bytes );
+                data += bytes;
+            }
+        }
+
+        if( ::rename( tmpName.str().c_str(), filename.c_str( )) != 0 )
+        {
+            LBWARN << "Cannot save synapse cache " << filename << ": "
+                   << ::strerror( errno ) << std::endl;
+            ::unlink( tmpName.str().c_str( ));
+            return false;
+        }
+        LBINFO << "Saved synapse cache " << filename << " with "
+               << header->numSynapses << " synapses" << std::endl;
+        return true;
+    }
+};
+
+SynapseCache::SynapseCache( const std::string& directory,
+                            const servus::uint128_t& key,
+                            const StreamFactory& newStream )
+    : _impl( new SynapseCache::Impl( directory, key, newStream ))
+{}
+
+SynapseCache::~SynapseCache()
+{}
+
+size_t SynapseCache::getNumSynapses() const
+{
+    return _impl->header->numSynapses;
+}
+
+const float* SynapseCache::getPositionsX() const
+{
+    return _impl->posX;
+}
+
+const float* SynapseCache::getPositionsY() const
+{
+    return _impl->posY;
+}
+
+const float* SynapseCache::getPositionsZ() const
+{
+    return _impl->posZ;
+}
+
+}
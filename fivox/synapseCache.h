@@ -0,0 +1,80 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FIVOX_SYNAPSECACHE_H
+#define FIVOX_SYNAPSECACHE_H
+
+#include <fivox/types.h>
+
+#include <brain/types.h>
+#include <servus/uint128_t.h>
+
+#include <functional>
+#include <memory>
+
+namespace fivox
+{
+
+/**
+ * Presynaptic surface positions of a set of synapses, cached in a file.
+ *
+ * The positions are read once from a synapse stream and saved in the cache
+ * directory, in a file named after the key of the synapses. Later sessions
+ * memory-map the saved positions, which are stored as three arrays of x, y and
+ * z coordinates.
+ */
+class SynapseCache
+{
+public:
+    typedef std::function< brain::SynapsesStream() > StreamFactory;
+
+    /**
+     * Open the cached positions of the given synapses, reading and saving
+     * them if they are not cached yet.
+     *
+     * @param directory the cache directory, created if it does not exist
+     * @param key identifies the synapses and the circuit they are read from
+     * @param newStream creates the stream of the synapses to cache
+     * @throw std::runtime_error if the directory can not be created
+     */
+    SynapseCache( const std::string& directory, const servus::uint128_t& key,
+                  const StreamFactory& newStream );
+    ~SynapseCache();
+
+    /** @return the number of cached synapses. */
+    size_t getNumSynapses() const;
+
+    /** @return the x coordinates of the synapse positions. */
+    const float* getPositionsX() const;
+
+    /** @return the y coordinates of the synapse positions. */
+    const float* getPositionsY() const;
+
+    /** @return the z coordinates of the synapse positions. */
+    const float* getPositionsZ() const;
+
+private:
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+}
+
+#endif
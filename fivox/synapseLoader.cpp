@@ -18,15 +18,32 @@
  */
 
 #include "synapseLoader.h"
+#include "synapseCache.h"
 #include "uriHandler.h"
+#include <fivox/version.h>
 
 #include <brain/brain.h>
+#include <brion/blueConfig.h>
+#include <lunchbox/clock.h>
+#include <lunchbox/debug.h>
+#include <lunchbox/log.h>
 
+#include <algorithm>
+#include <deque>
 #include <future>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
 
 
 namespace fivox
 {
+namespace
+{
+// number of cached synapses per chunk
+const size_t _cacheChunkSize = 65536;
+}
 
 class SynapseLoader::Impl
 {
@@ -36,8 +53,12 @@ public:
         , _circuit( params.getConfig( ))
         , _preGIDs( params.getPreGIDs( ))
         , _postGIDs( params.getGIDs( ))
-        , _synapses( _loadSynapseStream( ))
-        , _numChunks( _synapses.getRemaining( ))
+        , _cache( _openCache( params ))
+        , _synapses( _cache ? nullptr : _newSynapseStream( ))
+        , _numChunks( _cache ? ( _cache->getNumSynapses() +
+                                 _cacheChunkSize - 1 ) / _cacheChunkSize
+                             : _synapses->getRemaining( ))
+        , _maxReads( params.getSynapseReads( ))
     {
         if( !params.getReferenceVolume().empty( ))
             return;
@@ -63,30 +84,201 @@ public:
                                             brain::SynapsePrefetch::positions );
     }
 
-    ssize_t load( const size_t /*chunkIndex*/, const size_t numChunks )
+    std::shared_ptr< brain::SynapsesStream > _newSynapseStream()
+    {
+        return std::make_shared< brain::SynapsesStream >(
+            _loadSynapseStream( ));
+    }
+
+    std::unique_ptr< SynapseCache > _openCache( const URIHandler& params )
+    {
+        const std::string& directory = params.getSynapseCache();
+        if( directory.empty( ))
+            return nullptr;
+
+        try
+        {
+            return std::unique_ptr< SynapseCache >( new SynapseCache(
+                directory, _getCacheKey( params ),
+                [this] { return _loadSynapseStream(); }));
+        }
+        catch( const std::exception& e )
+        {
+            LBWARN << "Reading synapses without cache: " << e.what()
+                   << std::endl;
+            return nullptr;
+        }
+    }
+
+    // identifies the circuit, its synapse files and the pre- and
+    // postsynaptic GIDs
+    servus::uint128_t _getCacheKey( const URIHandler& params ) const
     {
-        // prefetching the next chunk (instead of synchronously waiting here)
-        // turned out to be slower in real life...
-        const brain::Synapses synapses = _synapses.read( numChunks ).get();
-        if( _synapses.eos( ))
-            _synapses = _loadSynapseStream();
-        _output.resize( synapses.size( ));
-        const float* __restrict__ posx = synapses.preSurfaceXPositions();
-        const float* __restrict__ posy = synapses.preSurfaceYPositions();
-        const float* __restrict__ posz = synapses.preSurfaceZPositions();
-        for( size_t i = 0; i < synapses.size(); ++i )
-            _output.update( i, Vector3f( posx[i], posy[i], posz[i] ),
+        std::ostringstream os;
+        os << "Fivox " << Version::getString();
+
+        const std::string synapses =
+            params.getConfig().getSynapseSource().getPath();
+        const std::string files[] = { params.getConfigPath(), synapses,
+                                      synapses + "/nrn_positions.h5" };
+        for( const std::string& file : files )
+        {
+            os << ", " << file;
+            struct stat info;
+            if( ::stat( file.c_str(), &info ) == 0 )
+                os << " " << info.st_size << " " << info.st_mtime;
+        }
+        os << ", " << _preGIDs.size() << " presynaptic GIDs, "
+           << _postGIDs.size() << " postsynaptic GIDs: ";
+
+        std::string key = os.str();
+        for( const brain::GIDSet* gids : { &_preGIDs, &_postGIDs })
+            for( const uint32_t gid : *gids )
+                key.append( reinterpret_cast< const char* >( &gid ),
+                            sizeof( gid ));
+        return servus::make_uint128( key );
+    }
+
+    ssize_t load( const size_t chunkIndex, const size_t numChunks )
+    {
+        if( _cache )
+            return _loadCached( chunkIndex, numChunks );
+
+        // a stream only reads on from its current position, so start a new
+        // one for a new pass or any other chunk than the next one
+        if( chunkIndex != _nextLoad )
+            _restart( chunkIndex );
+
+        // time spent by the caller since the previous chunk of this pass
+        if( _stats.numChunks > 0 )
+            _stats.sample += _clock.resetTimef();
+        else
+            _clock.reset();
+
+        // Each chunk is read on its own, keeping up to _maxReads reads of
+        // this pass in flight, so the next chunks are read while the current
+        // ones are sampled. The default of one read waits synchronously,
+        // which turned out to be the fastest on some filesystems.
+        const size_t endChunk = std::min( chunkIndex + numChunks, _numChunks );
+        std::vector< brain::Synapses > chunks;
+        size_t numSynapses = 0;
+        for( size_t chunk = chunkIndex; chunk < endChunk; ++chunk )
+        {
+            while( _reads.size() < _maxReads && _nextRead < _numChunks )
+                _reads.push_back( _read( ));
+
+            Read read = std::move( _reads.front( ));
+            _reads.pop_front();
+            LBASSERT( read.chunk == chunk );
+            chunks.push_back( read.synapses.get( ));
+            numSynapses += chunks.back().size();
+        }
+        _nextLoad = endChunk;
+        _stats.read += _clock.resetTimef();
+
+        _output.resize( numSynapses );
+        size_t first = 0;
+        for( const brain::Synapses& synapses : chunks )
+        {
+            _output.update( first, synapses.size(),
+                            synapses.preSurfaceXPositions(),
+                            synapses.preSurfaceYPositions(),
+                            synapses.preSurfaceZPositions(),
                             /*radius*/ 0.f, /*value*/ 1.f );
+            first += synapses.size();
+        }
+        _stats.convert += _clock.resetTimef();
+        _stats.numSynapses += numSynapses;
+        _stats.numChunks += chunks.size();
+
+        if( _nextLoad == _numChunks )
+        {
+            LBINFO << "Loaded " << _stats.numSynapses << " synapses in "
+                   << _stats.numChunks << " chunks with " << _maxReads
+                   << " reads in flight: " << _stats.read << " ms waiting "
+                   << "for reads, " << _stats.convert << " ms converting, "
+                   << _stats.sample << " ms sampling" << std::endl;
+            _stats = Stats();
+        }
+        return numSynapses;
+    }
+
+    struct Read
+    {
+        // keeps the stream alive until its read is done
+        std::shared_ptr< brain::SynapsesStream > stream;
+        std::future< brain::Synapses > synapses;
+        size_t chunk;
+    };
+
+    // read the next chunk, one GID of the stream
+    Read _read()
+    {
+        Read read{ _synapses, _synapses->read( 1 ), _nextRead++ };
+        if( _nextRead == _numChunks )
+            _synapses.reset(); // no reads beyond the end of this pass
+        return read;
+    }
+
+    // start a new stream positioned at the given chunk
+    void _restart( const size_t chunkIndex )
+    {
+        for( Read& read : _reads )
+            read.synapses.wait();
+        _reads.clear();
+        _stats = Stats();
+
+        _synapses = _newSynapseStream();
+        _nextRead = 0;
+        _nextLoad = chunkIndex;
+        if( chunkIndex == 0 || chunkIndex >= _numChunks )
+            return;
 
-        return synapses.size();
+        LBWARN << "Skipping " << chunkIndex << " synapse chunks to read "
+               << "them out of order" << std::endl;
+        _synapses->read( chunkIndex ).get();
+        _nextRead = chunkIndex;
     }
 
+    ssize_t _loadCached( const size_t chunkIndex, const size_t numChunks )
+    {
+        const size_t numSynapses = _cache->getNumSynapses();
+        const size_t first = std::min( chunkIndex * _cacheChunkSize,
+                                       numSynapses );
+        const size_t count = std::min( numChunks * _cacheChunkSize,
+                                       numSynapses - first );
+
+        _output.resize( count );
+        _output.update( 0, count, _cache->getPositionsX() + first,
+                        _cache->getPositionsY() + first,
+                        _cache->getPositionsZ() + first,
+                        /*radius*/ 0.f, /*value*/ 1.f );
+        return count;
+    }
+
+    struct Stats
+    {
+        float read = 0.f;
+        float convert = 0.f;
+        float sample = 0.f;
+        size_t numSynapses = 0;
+        size_t numChunks = 0;
+    };
+
     EventSource& _output;
     const brain::Circuit _circuit;
     const brain::GIDSet _preGIDs;
     const brain::GIDSet _postGIDs;
-    brain::SynapsesStream _synapses;
+    std::unique_ptr< SynapseCache > _cache; // null if not cached
+    // null if cached, or once all chunks of the current pass are read
+    std::shared_ptr< brain::SynapsesStream > _synapses;
     const size_t _numChunks;
+    const size_t _maxReads;
+    std::deque< Read > _reads; // of the chunks from _nextLoad to _nextRead
+    size_t _nextRead = 0; // the next chunk read from _synapses
+    size_t _nextLoad = 0; // the next chunk in order for load()
+    lunchbox::Clock _clock;
+    Stats _stats;
 };
 
 SynapseLoader::SynapseLoader( const URIHandler& params )
@@ -46,6 +46,8 @@ namespace fivox
 {
 class EventSource;
 class URIHandler;
+class VolumeSeriesReader;
+class VolumeSeriesWriter;
 template< class TImage > class EventFunctor;
 template< typename TImage > class ImageSource;
 
@@ -53,6 +55,7 @@ typedef std::shared_ptr< EventSource > EventSourcePtr;
 typedef std::shared_ptr< const EventSource > ConstEventSourcePtr;
 
 typedef itk::Image< uint8_t, 3 > ByteVolume;
+typedef itk::Image< uint16_t, 3 > ShortVolume;
 typedef itk::Image< float, 3 > FloatVolume;
 
 struct EventsDeleter
@@ -115,6 +118,15 @@ enum class EventFileFormat
     binary
 };
 
+/** Supported data types of the voxels in volume series files */
+enum class VolumeDataType
+{
+    uint8,
+    uint16,
+    uint32,
+    float32
+};
+
 /** Indicates to consider all data for potential rescaling. */
 const Vector2f FULLDATARANGE( -std::numeric_limits< float >::infinity(),
                                std::numeric_limits< float >::infinity( ));
@@ -34,6 +34,7 @@
 #include <fivox/eventValueSummationImageSource.h>
 #include <fivox/functorImageSource.h>
 #include <fivox/genericLoader.h>
+#include <fivox/quantizeFunctor.h>
 #include <fivox/somaLoader.h>
 #include <fivox/spikeLoader.h>
 #include <fivox/synapseLoader.h>
@@ -57,6 +58,13 @@ using boost::lexical_cast;
 const float _duration = 10.0f;
 const float _dt = -1.0f; // loaders use experiment/report dt
 const size_t _maxBlockSize = LB_64MB;
+const size_t _frameCacheSize = 0;
+const size_t _cacheSize = LB_1GB;
+const size_t _downsamplingCacheSize = LB_512MB;
+const size_t _reuseCacheSize = LB_256MB;
+const size_t _prefetchFrames = 2;
+const size_t _prefetchSize = LB_512MB;
+const size_t _synapseReads = 1;
 const float _cutoff = 100.0f; // micrometers
 const float _extend = 0.f; // micrometers
 const float _gidFraction = 1.f;
@@ -183,6 +191,9 @@ public:
 
     Vector2f getInputRange() const
     {
+        if( getInputPercentiles() != Vector2f( 0.f, 100.f ))
+            return FULLDATARANGE;
+
         Vector2f defaultValue( brion::MINIMUM_VOLTAGE, 0.f );
         switch( getType( ))
         {
@@ -212,6 +223,14 @@ public:
                          _get( "inputMax", defaultValue[1] ));
     }
 
+    Vector2f getInputPercentiles() const
+    {
+        const float minPercentile = _get( "inputMinPercentile", 0.f );
+        const float maxPercentile = _get( "inputMaxPercentile", 100.f );
+        return Vector2f( std::max( 0.f, std::min( minPercentile, 100.f )),
+                         std::max( 0.f, std::min( maxPercentile, 100.f )));
+    }
+
     float getResolution() const
     {
         float defaultResolution = 0.1f;
@@ -230,6 +249,40 @@ public:
     size_t getMaxBlockSize() const
         { return _get( "maxBlockSize", _maxBlockSize ); }
 
+    bool useEventLOD() const;
+
+    std::string getCacheDirectory() const { return _get( "cache" ); }
+
+    std::string getGeometryCache() const { return _get( "geometryCache" ); }
+
+    size_t getFrameCacheSize() const
+        { return _get( "frameCache", _frameCacheSize ); }
+
+    size_t getCacheSize() const
+        { return _get( "cacheSize", _cacheSize ); }
+
+    std::string getDownsampling() const { return _get( "downsample" ); }
+
+    size_t getDownsamplingCacheSize() const
+        { return _get( "downsampleCacheSize", _downsamplingCacheSize ); }
+
+    size_t getReuseCacheSize() const
+        { return _get( "reuseCacheSize", _reuseCacheSize ); }
+
+    size_t getPrefetchFrames() const
+        { return _get( "prefetch", _prefetchFrames ); }
+
+    size_t getPrefetchSize() const
+        { return _get( "prefetchSize", _prefetchSize ); }
+
+    bool prefetchBricks() const;
+
+    std::string getSynapseCache() const { return _get( "synapseCache" ); }
+
+    size_t getSynapseReads() const
+        { return std::max( _get( "synapseReads", _synapseReads ),
+                           size_t( 1 )); }
+
     float getCutoffDistance() const
         { return std::max( _get( "cutoff", _cutoff ), 0.f ); }
 
@@ -389,6 +442,16 @@ template<> bool URIHandler::Impl::_get( const std::string& param,
     }
 }
 
+bool URIHandler::Impl::useEventLOD() const
+{
+    return _get( "eventLOD", true );
+}
+
+bool URIHandler::Impl::prefetchBricks() const
+{
+    return _get( "prefetchBricks", false );
+}
+
 URIHandler::URIHandler( const URI& params )
     : _impl( new URIHandler::Impl( params ))
 {}
@@ -446,6 +509,11 @@ Vector2f URIHandler::getInputRange() const
     return _impl->getInputRange();
 }
 
+Vector2f URIHandler::getInputPercentiles() const
+{
+    return _impl->getInputPercentiles();
+}
+
 float URIHandler::getResolution() const
 {
     return _impl->getResolution();
@@ -456,6 +524,71 @@ size_t URIHandler::getMaxBlockSize() const
     return _impl->getMaxBlockSize();
 }
 
+bool URIHandler::useEventLOD() const
+{
+    return _impl->useEventLOD();
+}
+
+std::string URIHandler::getCacheDirectory() const
+{
+    return _impl->getCacheDirectory();
+}
+
+std::string URIHandler::getGeometryCache() const
+{
+    return _impl->getGeometryCache();
+}
+
+size_t URIHandler::getFrameCacheSize() const
+{
+    return _impl->getFrameCacheSize();
+}
+
+size_t URIHandler::getCacheSize() const
+{
+    return _impl->getCacheSize();
+}
+
+std::string URIHandler::getDownsampling() const
+{
+    return _impl->getDownsampling();
+}
+
+size_t URIHandler::getDownsamplingCacheSize() const
+{
+    return _impl->getDownsamplingCacheSize();
+}
+
+size_t URIHandler::getReuseCacheSize() const
+{
+    return _impl->getReuseCacheSize();
+}
+
+size_t URIHandler::getPrefetchFrames() const
+{
+    return _impl->getPrefetchFrames();
+}
+
+size_t URIHandler::getPrefetchSize() const
+{
+    return _impl->getPrefetchSize();
+}
+
+bool URIHandler::prefetchBricks() const
+{
+    return _impl->prefetchBricks();
+}
+
+std::string URIHandler::getSynapseCache() const
+{
+    return _impl->getSynapseCache();
+}
+
+size_t URIHandler::getSynapseReads() const
+{
+    return _impl->getSynapseReads();
+}
+
 float URIHandler::getCutoffDistance() const
 {
     return _impl->getCutoffDistance();
@@ -516,8 +649,21 @@ Parameters for all types :
              [-15.0, 0.0] for Somas with TestData, [-80.0, 0.0] otherwise
              [-0.0000147, 0.00225] for LFP with TestData, [-10.0, 10.0] otherwise
              [-100000.0, 300.0] for VSD)
+- inputMinPercentile/inputMaxPercentile: rescale from the given percentiles in
+  [0, 100] of the sampled values instead of inputMin/inputMax (default: unset)
 - functor: type of functor to sample the data into the voxels (defaults: 'density' for Synapses, 'frequency' for Spikes, 'field' for Compartments, Somas and VSD)
 - maxBlockSize: maximum memory usage allowed for one block in bytes (default: 64MB)
+- frameCache: number of recently loaded frames kept in memory to switch back to them without reading the data source again, e.g. when browsing a few frames interactively (default: 0)
+- eventLOD: sample coarse Livre levels from events aggregated to the voxel size, for the 'field' and 'lfp' functors (default: 1)
+- cache: directory to keep the bricks sampled by Livre across sessions (default: unset, no cache)
+- geometryCache: directory to keep the events computed from the morphologies for Compartments, Somas and VSD, so later runs with the same, unmodified circuit and morphology files, GIDs and report mapping load them from there (default: unset, no cache)
+- cacheSize: maximum size of the brick cache in bytes, least recently used bricks are removed (default: 1GB)
+- downsample: build coarse Livre bricks by 'box' or 'gaussian' downsampling of their children if these were sampled already (default: unset, always sample the events)
+- downsampleCacheSize: maximum size in bytes of the bricks kept in memory for downsampling (default: 512MB)
+- reuseCacheSize: maximum size in bytes of the bricks kept to reuse them for other timesteps if the values of the events within the cutoff distance did not change, 0 to always sample them (default: 256MB)
+- prefetch: number of timesteps loaded ahead in the background while Livre plays the timesteps in order (default: 2)
+- prefetchSize: maximum size in bytes of the timesteps and bricks prefetched in the background (default: 512MB)
+- prefetchBricks: also sample the bricks of the current timestep for the prefetched timesteps (default: 0)
 - cutoff: the cutoff distance in micrometers (default: 100)
 - extend: the additional distance, in micrometers, by which the original data volume will be extended in every dimension (default: 0, the volume extent matches the bounding box of the data events). Changing this parameter will result in more volumetric data, and therefore more computation time
 - reference: path to a reference volume to take its size and resolution, overwrites the 'size' and 'resolution' parameter
@@ -536,6 +682,10 @@ Parameters for Spikes:
 - duration: time window in milliseconds to load spikes (default: 10)
 - spikes: path to an alternate out.dat/out.spikes file (default: SpikesPath specified in the BlueConfig)
 
+Parameters for Synapses:
+- synapseCache: directory to keep the synapse positions read for a circuit and its targets, so later runs read them from there (default: unset, no cache)
+- synapseReads: number of synapse chunk reads kept in flight, the ones beyond the first are read in the background while the current chunk is sampled (default: 1)
+
 Parameters for VSD:
 - report: name of the voltage report (default: 'soma'; 'voltage' if BlueConfig is BBPTestData)
 - areas: path to an area report file (default: path to TestData areas if BlueConfig is BBPTestData)
@@ -544,9 +694,11 @@ Parameters for VSD:
 }
 
 template< class TImage >
-ImageSourcePtr< TImage > URIHandler::newImageSource() const
+ImageSourcePtr< TImage >
+URIHandler::newImageSource( EventSourcePtr eventSource ) const
 {
-    EventSourcePtr eventSource = newEventSource();
+    if( !eventSource )
+        eventSource = newEventSource();
 
     ImageSourcePtr< TImage > source;
     switch( getFunctorType( ))
@@ -590,6 +742,42 @@ ImageSourcePtr< TImage > URIHandler::newImageSource() const
     return source;
 }
 
+template< class TImage >
+ImageSourcePtr< TImage >
+URIHandler::newScaledImageSource( EventSourcePtr eventSource ) const
+{
+    const Vector2f& inputRange = getInputRange();
+    if( getFunctorType() == FunctorType::unknown ||
+        inputRange == FULLDATARANGE )
+    {
+        return nullptr;
+    }
+
+    auto functor = newFunctor< FloatVolume >();
+    if( !functor )
+        return nullptr;
+
+    if( !eventSource )
+        eventSource = newEventSource();
+    functor->setEventSource( eventSource );
+
+    auto quantizeFunctor =
+        std::make_shared< QuantizeFunctor< TImage >>( functor, inputRange );
+    quantizeFunctor->setEventSource( eventSource );
+
+    auto functorSource = FunctorImageSource< TImage >::New();
+    functorSource->setFunctor( quantizeFunctor );
+    ImageSourcePtr< TImage > source = functorSource;
+
+    LBINFO << "Ready to voxelize " << *this << " scaled from values in ["
+           << inputRange[0] << ", " << inputRange[1] << "], dt = "
+           << eventSource->getDt() << std::endl;
+
+    source->setEventSource( eventSource );
+    source->setup( *this );
+    return source;
+}
+
 EventSourcePtr URIHandler::newEventSource() const
 {
     switch( getType( ))
@@ -642,9 +830,13 @@ std::ostream& operator << ( std::ostream& os, const URIHandler& params )
 
 // template instantiations
 template fivox::ImageSourcePtr< fivox::ByteVolume >
-    fivox::URIHandler::newImageSource() const;
+    fivox::URIHandler::newImageSource( fivox::EventSourcePtr ) const;
 template fivox::ImageSourcePtr< fivox::FloatVolume >
-    fivox::URIHandler::newImageSource() const;
+    fivox::URIHandler::newImageSource( fivox::EventSourcePtr ) const;
+template fivox::ImageSourcePtr< fivox::ByteVolume >
+    fivox::URIHandler::newScaledImageSource( fivox::EventSourcePtr ) const;
+template fivox::ImageSourcePtr< fivox::ShortVolume >
+    fivox::URIHandler::newScaledImageSource( fivox::EventSourcePtr ) const;
 template fivox::EventFunctorPtr< fivox::ByteVolume >
     fivox::URIHandler::newFunctor() const;
 template fivox::EventFunctorPtr< fivox::FloatVolume >
@@ -128,6 +128,16 @@ public:
      */
     FIVOX_API Vector2f getInputRange() const;
 
+    /**
+     * Get the percentiles of the sampled values to use as input range for
+     * rescaling. If set, getInputRange() returns FULLDATARANGE and the range
+     * is computed from the statistics gathered while sampling.
+     *
+     * @return the minimum and maximum percentiles in [0, 100], (0, 100) by
+     *         default.
+     */
+    FIVOX_API Vector2f getInputPercentiles() const;
+
     /**
      * Get the specified resolution in voxels per unit (typically um).
      *
@@ -143,6 +153,114 @@ public:
      */
     FIVOX_API size_t getMaxBlockSize() const;
 
+    /**
+     * Get the number of recently loaded frames whose event values are kept in
+     * memory, so that loading them again does not read the data source.
+     *
+     * @return the specified number of cached frames. If invalid or empty,
+     *         return 0, i.e. only the last loaded frame is kept
+     */
+    FIVOX_API size_t getFrameCacheSize() const;
+
+    /**
+     * @return true if coarse levels of the Livre data source are sampled from
+     *         proxy events aggregating the events (default), see
+     *         EventSource::createProxies().
+     */
+    FIVOX_API bool useEventLOD() const;
+
+    /**
+     * Get the directory of the persistent brick cache of the Livre data
+     * source.
+     *
+     * @return the cache directory, empty to disable the cache (default).
+     */
+    FIVOX_API std::string getCacheDirectory() const;
+
+    /**
+     * Get the directory in which the compartment, soma and VSD loaders cache
+     * the events computed from the morphologies.
+     *
+     * @return the cache directory, empty to disable the cache (default).
+     */
+    FIVOX_API std::string getGeometryCache() const;
+
+    /**
+     * Get the maximum size of the persistent brick cache (bytes).
+     *
+     * @return the specified maximum cache size. If invalid or empty, return
+     *         1GB
+     */
+    FIVOX_API size_t getCacheSize() const;
+
+    /**
+     * Get the filter to build coarse bricks of the Livre data source from
+     * their children, if these were sampled already.
+     *
+     * @return "box" or "gaussian", empty to always sample the events (default).
+     */
+    FIVOX_API std::string getDownsampling() const;
+
+    /**
+     * Get the maximum size of the bricks kept in memory for downsampling
+     * (bytes).
+     *
+     * @return the specified maximum size. If invalid or empty, return 512MB
+     */
+    FIVOX_API size_t getDownsamplingCacheSize() const;
+
+    /**
+     * Get the maximum size of the bricks kept by the Livre data source to
+     * reuse them for other timesteps in which the values of their events do
+     * not change (bytes).
+     *
+     * @return the specified maximum size, 0 to always sample the bricks. If
+     *         invalid or empty, return 256MB
+     */
+    FIVOX_API size_t getReuseCacheSize() const;
+
+    /**
+     * Get the number of timesteps the Livre data source loads ahead in the
+     * background during sequential playback.
+     *
+     * @return the specified number of prefetched timesteps, 0 to disable
+     *         prefetching. If invalid or empty, return 2
+     */
+    FIVOX_API size_t getPrefetchFrames() const;
+
+    /**
+     * Get the maximum memory used by the prefetched timesteps and bricks
+     * (bytes).
+     *
+     * @return the specified prefetch memory budget. If invalid or empty,
+     *         return 512MB
+     */
+    FIVOX_API size_t getPrefetchSize() const;
+
+    /**
+     * @return true if the Livre data source also samples the bricks of the
+     *         current timestep for the prefetched timesteps, false otherwise
+     *         (default).
+     */
+    FIVOX_API bool prefetchBricks() const;
+
+    /**
+     * Get the directory in which the synapse loader caches the synapse
+     * positions of a circuit and its targets.
+     *
+     * @return the specified directory, empty if the positions are not cached
+     */
+    FIVOX_API std::string getSynapseCache() const;
+
+    /**
+     * Get the number of synapse chunk reads the synapse loader keeps in
+     * flight. Reads beyond the first one overlap with the sampling of the
+     * current chunk.
+     *
+     * @return the specified number of reads. If invalid or empty, return 1
+     */
+    FIVOX_API size_t getSynapseReads() const;
+
     /**
      * Get the specified cutoff distance in micrometers.
      *
@@ -195,9 +313,27 @@ public:
     /** @return an exhaustive list of the URIs accepted. */
     FIVOX_API static std::string getHelp();
 
-    /** @return a new image source for the given parameters and pixel type. */
-    FIVOX_API template< class TImage > ImageSourcePtr< TImage > newImageSource()
-        const;
+    /**
+     * @param eventSource the event source to sample, a new one from
+     *                    newEventSource() if not given
+     * @return a new image source for the given parameters and pixel type.
+     */
+    FIVOX_API template< class TImage > ImageSourcePtr< TImage >
+        newImageSource( EventSourcePtr eventSource = nullptr ) const;
+
+    /**
+     * Create an image source which windows and quantizes the sampled values
+     * into the pixel type while sampling, using getInputRange(), instead of
+     * scaling a floating point volume afterwards.
+     *
+     * @param eventSource the event source to sample, a new one is created if
+     *                    not given
+     * @return a new image source for the given parameters and pixel type, or
+     *         nullptr if the functor or the input range do not allow
+     *         quantization while sampling (no functor or FULLDATARANGE).
+     */
+    FIVOX_API template< class TImage > ImageSourcePtr< TImage >
+        newScaledImageSource( EventSourcePtr eventSource = nullptr ) const;
 
     /** @return a new functor for the given parameters and pixel type. */
     FIVOX_API template< class TImage > EventFunctorPtr< TImage > newFunctor()
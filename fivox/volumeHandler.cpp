@@ -62,6 +62,53 @@ VolumeHandler::computeRegion( const Vector2ui& decompose ) const
     return FloatVolume::RegionType( vIndex, vSize );
 }
 
+FloatVolume::RegionType
+VolumeHandler::computeBrick( const Vector3ui& brick,
+                             const Vector3ui& numBricks ) const
+{
+    FloatVolume::IndexType vIndex;
+    FloatVolume::SizeType vSize;
+    for( size_t i = 0; i < 3; ++i )
+    {
+        const size_t size = _size * _extent[i] / _extent.find_max();
+        const size_t begin = float( size ) / float( numBricks[i] ) *
+                             float( brick[i] );
+        const size_t end = size_t( float( size ) / float( numBricks[i] ) *
+                                   float( brick[i] + 1 ));
+        vIndex[i] = begin;
+        vSize[i] = end - begin;
+    }
+    return FloatVolume::RegionType( vIndex, vSize );
+}
+
+Vector3ui VolumeHandler::computeBrickLayout( size_t numBricks ) const
+{
+    std::vector< size_t > factors;
+    for( size_t factor = 2; factor * factor <= numBricks; )
+    {
+        if( numBricks % factor == 0 )
+        {
+            factors.push_back( factor );
+            numBricks /= factor;
+        }
+        else
+            ++factor;
+    }
+    if( numBricks > 1 )
+        factors.push_back( numBricks );
+
+    Vector3ui layout( 1, 1, 1 );
+    for( auto i = factors.rbegin(); i != factors.rend(); ++i )
+    {
+        size_t axis = 0;
+        for( size_t j = 1; j < 3; ++j )
+            if( _extent[j] / layout[j] > _extent[axis] / layout[axis] )
+                axis = j;
+        layout[axis] *= *i;
+    }
+    return layout;
+}
+
 FloatVolume::SpacingType VolumeHandler::computeSpacing() const
 {
     FloatVolume::SpacingType spacing;
@@ -62,6 +62,29 @@ public:
     FIVOX_API FloatVolume::RegionType computeRegion( const Vector2ui& decompose)
         const;
 
+    /**
+     * Compute the region of one brick of a 3D brick decomposition
+     *
+     * @param brick 3D index of the brick to compute
+     * @param numBricks number of bricks along each of the volume axes
+     * @return an itk::Image::RegionType containing the starting index and size
+     * of the brick
+     */
+    FIVOX_API FloatVolume::RegionType computeBrick( const Vector3ui& brick,
+                                                    const Vector3ui& numBricks )
+        const;
+
+    /**
+     * Compute how to split the volume into a given number of bricks
+     *
+     * The number of bricks is factorized, assigning the largest factors to the
+     * axes with the largest brick extent to obtain bricks as cubic as possible.
+     *
+     * @param numBricks total number of bricks
+     * @return the number of bricks along each of the volume axes
+     */
+    FIVOX_API Vector3ui computeBrickLayout( size_t numBricks ) const;
+
     /**
      * Compute the spacing of the volume
      *
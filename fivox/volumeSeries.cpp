@@ -0,0 +1,734 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "volumeSeries.h"
+
+#include <lunchbox/debug.h>
+#include <lunchbox/log.h>
+#include <lunchbox/memoryMap.h>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace fivox
+{
+namespace
+{
+const uint32_t magic = 0xf5e1;
+const uint32_t version = 1;
+const size_t pageSize = 4096;
+
+/** Fixed header of a volume series file, followed by one flag per frame */
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dataType;
+    uint32_t numFrames;
+    uint32_t size[3];
+    uint32_t chunkSize[3];
+    float spacing[3];
+    float origin[3];
+};
+
+/** Computes the location of the chunks in a volume series file */
+struct Layout
+{
+    explicit Layout( const Header& header )
+        : size( header.size[0], header.size[1], header.size[2] )
+        , chunkSize( header.chunkSize[0], header.chunkSize[1],
+                     header.chunkSize[2] )
+        , numFrames( header.numFrames )
+        , elementSize( getVolumeDataSize( VolumeDataType( header.dataType )))
+        , chunkBytes( size_t( chunkSize[0] ) * chunkSize[1] * chunkSize[2] *
+                      elementSize )
+        , dataOffset(( sizeof( Header ) + numFrames + pageSize - 1 ) /
+                     pageSize * pageSize )
+    {
+        for( size_t i = 0; i < 3; ++i )
+            numChunks[i] = ( size[i] + chunkSize[i] - 1 ) / chunkSize[i];
+    }
+
+    size_t getFileSize() const
+    {
+        return dataOffset + size_t( numChunks[0] ) * numChunks[1] *
+                            numChunks[2] * numFrames * chunkBytes;
+    }
+
+    size_t getChunkOffset( const Vector3ui& chunk, const size_t frame ) const
+    {
+        const size_t index = chunk[0] +
+                             numChunks[0] * ( chunk[1] + numChunks[1] * chunk[2] );
+        return dataOffset + ( index * numFrames + frame ) * chunkBytes;
+    }
+
+    Vector3ui size;
+    Vector3ui chunkSize;
+    Vector3ui numChunks;
+    size_t numFrames;
+    size_t elementSize;
+    size_t chunkBytes;
+    size_t dataOffset;
+};
+
+Header _createHeader( const Vector3ui& size, const size_t numFrames,
+                      const Vector3ui& chunkSize, const VolumeDataType type )
+{
+    Header header;
+    ::memset( &header, 0, sizeof( header ));
+    header.magic = magic;
+    header.version = version;
+    header.dataType = uint32_t( type );
+    header.numFrames = uint32_t( numFrames );
+    for( size_t i = 0; i < 3; ++i )
+    {
+        if( size[i] == 0 || chunkSize[i] == 0 )
+            LBTHROW( std::runtime_error( "Invalid volume series size" ));
+        header.size[i] = size[i];
+        header.chunkSize[i] = std::min( chunkSize[i], size[i] );
+    }
+    return header;
+}
+}
+
+size_t getVolumeDataSize( const VolumeDataType type )
+{
+    switch( type )
+    {
+    case VolumeDataType::uint8:
+        return sizeof( uint8_t );
+    case VolumeDataType::uint16:
+        return sizeof( uint16_t );
+    case VolumeDataType::uint32:
+        return sizeof( uint32_t );
+    case VolumeDataType::float32:
+        return sizeof( float );
+    }
+    LBTHROW( std::runtime_error( "Unknown volume data type" ));
+}
+
+class VolumeSeriesWriter::Impl
+{
+public:
+    Impl( const std::string& filename, const Header& header_ )
+        : layout( header_ )
+        , file( filename, layout.getFileSize( ))
+        , header( file.getAddress< Header >( ))
+    {
+        if( !header )
+            LBTHROW( std::runtime_error( "Cannot create volume series " +
+                                         filename ));
+        *header = header_;
+        LBINFO << "Created volume series " << filename << " with "
+               << layout.numFrames << " frames of " << layout.size
+               << " voxels in chunks of " << layout.chunkSize << std::endl;
+    }
+
+    void writeFrame( const size_t frame, const uint8_t* data )
+    {
+        if( frame >= layout.numFrames )
+            LBTHROW( std::runtime_error( "Frame " + std::to_string( frame ) +
+                                         " out of range of volume series" ));
+
+        uint8_t* base = file.getAddress< uint8_t >();
+        const Vector3ui& size = layout.size;
+        const Vector3ui& chunkSize = layout.chunkSize;
+        const size_t elementSize = layout.elementSize;
+
+        Vector3ui chunk;
+        for( chunk[2] = 0; chunk[2] < layout.numChunks[2]; ++chunk[2] )
+        for( chunk[1] = 0; chunk[1] < layout.numChunks[1]; ++chunk[1] )
+        for( chunk[0] = 0; chunk[0] < layout.numChunks[0]; ++chunk[0] )
+        {
+            uint8_t* dst = base + layout.getChunkOffset( chunk, frame );
+            const Vector3ui begin( chunk * chunkSize );
+            const size_t rowSize = std::min( chunkSize[0], size[0] - begin[0] )
+                                   * elementSize;
+            const uint32_t endY = std::min( begin[1] + chunkSize[1], size[1] );
+            const uint32_t endZ = std::min( begin[2] + chunkSize[2], size[2] );
+
+            for( uint32_t z = begin[2]; z < endZ; ++z )
+            {
+                for( uint32_t y = begin[1]; y < endY; ++y )
+                {
+                    const size_t srcIndex =
+                        ( size_t( z ) * size[1] + y ) * size[0] + begin[0];
+                    const size_t dstIndex =
+                        (( z - begin[2] ) * chunkSize[1] + y - begin[1] ) *
+                        chunkSize[0];
+                    ::memcpy( dst + dstIndex * elementSize,
+                              data + srcIndex * elementSize, rowSize );
+                }
+            }
+        }
+        reinterpret_cast< uint8_t* >( header + 1 )[ frame ] = 1;
+    }
+
+    const Layout layout;
+    lunchbox::MemoryMap file;
+    Header* header;
+};
+
+VolumeSeriesWriter::VolumeSeriesWriter( const std::string& filename,
+                                        const Vector3ui& size,
+                                        const size_t numFrames,
+                                        const Vector3ui& chunkSize,
+                                        const VolumeDataType type )
+    : _impl( new Impl( filename,
+                       _createHeader( size, numFrames, chunkSize, type )))
+{}
+
+VolumeSeriesWriter::~VolumeSeriesWriter()
+{}
+
+void VolumeSeriesWriter::setSpacing( const Vector3f& spacing )
+{
+    for( size_t i = 0; i < 3; ++i )
+        _impl->header->spacing[i] = spacing[i];
+}
+
+void VolumeSeriesWriter::setOrigin( const Vector3f& origin )
+{
+    for( size_t i = 0; i < 3; ++i )
+        _impl->header->origin[i] = origin[i];
+}
+
+void VolumeSeriesWriter::writeFrame( const size_t frame, const void* data )
+{
+    _impl->writeFrame( frame, static_cast< const uint8_t* >( data ));
+}
+
+class VolumeSeriesReader::Impl
+{
+public:
+    explicit Impl( const std::string& filename )
+        : file( filename )
+        , header( _getHeader( filename ))
+        , layout( *header )
+        , spacing( header->spacing[0], header->spacing[1], header->spacing[2] )
+        , origin( header->origin[0], header->origin[1], header->origin[2] )
+    {
+        if( file.getSize() < layout.getFileSize( ))
+            LBTHROW( std::runtime_error( "Truncated volume series " +
+                                         filename ));
+    }
+
+    const Header* _getHeader( const std::string& filename ) const
+    {
+        const Header* header_ = file.getAddress< Header >();
+        if( !header_ || file.getSize() < sizeof( Header ) ||
+            header_->magic != magic )
+        {
+            LBTHROW( std::runtime_error( filename +
+                                         " is not a volume series file" ));
+        }
+        if( header_->version != version )
+            LBTHROW( std::runtime_error( "Bad version in " + filename ));
+        for( size_t i = 0; i < 3; ++i )
+            if( header_->chunkSize[i] == 0 )
+                LBTHROW( std::runtime_error( "Bad chunk size in " + filename ));
+        return header_;
+    }
+
+    bool hasFrame( const size_t frame ) const
+    {
+        return frame < layout.numFrames &&
+               reinterpret_cast< const uint8_t* >( header + 1 )[ frame ] != 0;
+    }
+
+    void read( const Vector3ui& begin, const Vector3ui& size,
+               const Vector2ui& frames, uint8_t* data ) const
+    {
+        const Vector3ui end( begin + size );
+        for( size_t i = 0; i < 3; ++i )
+        {
+            if( end[i] > layout.size[i] || begin[i] >= end[i] )
+                LBTHROW( std::runtime_error( "Region out of range of volume "
+                                             "series" ));
+        }
+        if( frames[1] > layout.numFrames || frames[0] >= frames[1] )
+            LBTHROW( std::runtime_error( "Frames out of range of volume "
+                                         "series" ));
+
+        const uint8_t* base = file.getAddress< uint8_t >();
+        const Vector3ui& chunkSize = layout.chunkSize;
+        const size_t elementSize = layout.elementSize;
+        const size_t frameSize = size_t( size[0] ) * size[1] * size[2];
+        const Vector3ui firstChunk( begin / chunkSize );
+        const Vector3ui lastChunk(( end - Vector3ui( 1 )) / chunkSize );
+
+        // all frames of one chunk are contiguous, so iterate frames last
+        Vector3ui chunk;
+        for( chunk[2] = firstChunk[2]; chunk[2] <= lastChunk[2]; ++chunk[2] )
+        for( chunk[1] = firstChunk[1]; chunk[1] <= lastChunk[1]; ++chunk[1] )
+        for( chunk[0] = firstChunk[0]; chunk[0] <= lastChunk[0]; ++chunk[0] )
+        {
+            const Vector3ui chunkBegin( chunk * chunkSize );
+            Vector3ui from, to;
+            for( size_t i = 0; i < 3; ++i )
+            {
+                from[i] = std::max( begin[i], chunkBegin[i] );
+                to[i] = std::min( end[i], chunkBegin[i] + chunkSize[i] );
+            }
+            const size_t rowSize = ( to[0] - from[0] ) * elementSize;
+
+            for( uint32_t frame = frames[0]; frame < frames[1]; ++frame )
+            {
+                const uint8_t* src = base + layout.getChunkOffset( chunk,
+                                                                   frame );
+                uint8_t* dst = data + ( frame - frames[0] ) * frameSize *
+                                      elementSize;
+                for( uint32_t z = from[2]; z < to[2]; ++z )
+                {
+                    for( uint32_t y = from[1]; y < to[1]; ++y )
+                    {
+                        const size_t srcIndex =
+                            (( z - chunkBegin[2] ) * chunkSize[1] + y -
+                             chunkBegin[1] ) * chunkSize[0] + from[0] -
+                            chunkBegin[0];
+                        const size_t dstIndex =
+                            (( z - begin[2] ) * size_t( size[1] ) + y -
+                             begin[1] ) * size[0] + from[0] - begin[0];
+                        ::memcpy( dst + dstIndex * elementSize,
+                                  src + srcIndex * elementSize, rowSize );
+                    }
+                }
+            }
+        }
+    }
+
+    lunchbox::MemoryMap file;
+    const Header* header;
+    const Layout layout;
+    const Vector3f spacing;
+    const Vector3f origin;
+};
+
+VolumeSeriesReader::VolumeSeriesReader( const std::string& filename )
+    : _impl( new Impl( filename ))
+{}
+
+VolumeSeriesReader::~VolumeSeriesReader()
+{}
+
+const Vector3ui& VolumeSeriesReader::getSize() const
+{
+    return _impl->layout.size;
+}
+
+const Vector3ui& VolumeSeriesReader::getChunkSize() const
+{
+    return _impl->layout.chunkSize;
+}
+
+size_t VolumeSeriesReader::getNumFrames() const
+{
+    return _impl->layout.numFrames;
+}
+
+VolumeDataType VolumeSeriesReader::getDataType() const
+{
+    return VolumeDataType( _impl->header->dataType );
+}
+
+const Vector3f& VolumeSeriesReader::getSpacing() const
+{
+    return _impl->spacing;
+}
+
+const Vector3f& VolumeSeriesReader::getOrigin() const
+{
+    return _impl->origin;
+}
+
+bool VolumeSeriesReader::hasFrame( const size_t frame ) const
+{
+    return _impl->hasFrame( frame );
+}
+
+void VolumeSeriesReader::read( const Vector3ui& begin, const Vector3ui& size,
+                               const Vector2ui& frames, void* data ) const
+{
+    _impl->read( begin, size, frames, static_cast< uint8_t* >( data ));
+}
+
+void VolumeSeriesReader::readFrame( const size_t frame, void* data ) const
+{
+    _impl->read( Vector3ui( 0 ), _impl->layout.size,
+                 Vector2ui( frame, frame + 1 ), static_cast< uint8_t* >( data ));
+}
+
+namespace
+{
+const uint32_t deltaMagic = 0xf5e2;
+
+// shortest run of unchanged bytes worth starting a new delta record
+const size_t minZeroRun = 8;
+const size_t maxRun = std::numeric_limits< uint32_t >::max();
+
+/** Fixed header of a delta volume series file */
+struct DeltaHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dataType;
+    uint32_t numFrames;
+    uint32_t size[3];
+    uint32_t keyframeInterval;
+    float spacing[3];
+    float origin[3];
+    uint64_t indexOffset; // offset and size of each frame, after the frames
+};
+
+void _append( std::vector< uint8_t >& out, const uint32_t value )
+{
+    const uint8_t* bytes = reinterpret_cast< const uint8_t* >( &value );
+    out.insert( out.end(), bytes, bytes + sizeof( value ));
+}
+
+/**
+ * Encode the XOR of two frames as records of (zero run, literal count,
+ * literals), skipping the bytes which did not change.
+ */
+void _encodeDelta( const uint8_t* current, const uint8_t* previous,
+                   const size_t size, std::vector< uint8_t >& out )
+{
+    out.clear();
+    size_t i = 0;
+    while( i < size )
+    {
+        const size_t zeroStart = i;
+        while( i < size && i - zeroStart < maxRun && current[i] == previous[i] )
+            ++i;
+
+        const size_t literalStart = i;
+        size_t literalEnd = i;
+        size_t zeros = 0;
+        while( i < size && i - literalStart < maxRun )
+        {
+            if( current[i] == previous[i] )
+            {
+                if( ++zeros == minZeroRun )
+                    break;
+            }
+            else
+            {
+                zeros = 0;
+                literalEnd = i + 1;
+            }
+            ++i;
+        }
+        i = literalEnd;
+
+        _append( out, uint32_t( literalStart - zeroStart ));
+        _append( out, uint32_t( literalEnd - literalStart ));
+        for( size_t j = literalStart; j < literalEnd; ++j )
+            out.push_back( current[j] ^ previous[j] );
+    }
+}
+
+void _decodeDelta( const uint8_t* delta, const size_t deltaSize,
+                   uint8_t* frame, const size_t size )
+{
+    size_t pos = 0;
+    const uint8_t* const end = delta + deltaSize;
+    while( delta + 2 * sizeof( uint32_t ) <= end )
+    {
+        uint32_t zeroRun, literalCount;
+        ::memcpy( &zeroRun, delta, sizeof( zeroRun ));
+        ::memcpy( &literalCount, delta + sizeof( zeroRun ),
+                  sizeof( literalCount ));
+        delta += 2 * sizeof( uint32_t );
+
+        pos += zeroRun;
+        if( pos + literalCount > size || delta + literalCount > end )
+            LBTHROW( std::runtime_error( "Corrupt delta frame" ));
+
+        for( uint32_t i = 0; i < literalCount; ++i )
+            frame[pos++] ^= *delta++;
+    }
+    if( delta != end || pos > size )
+        LBTHROW( std::runtime_error( "Corrupt delta frame" ));
+}
+}
+
+class DeltaVolumeSeriesWriter::Impl
+{
+public:
+    Impl( const std::string& filename, const Vector3ui& size,
+          const size_t keyframeInterval, const VolumeDataType type )
+        : file( filename.c_str(), std::ios::binary | std::ios::trunc )
+        , frameSize( size_t( size[0] ) * size[1] * size[2] *
+                     getVolumeDataSize( type ))
+    {
+        if( !file.is_open( ))
+            LBTHROW( std::runtime_error( "Cannot create delta volume series "
+                                         + filename ));
+        if( keyframeInterval == 0 || frameSize == 0 )
+            LBTHROW( std::runtime_error( "Invalid delta volume series size" ));
+
+        ::memset( &header, 0, sizeof( header ));
+        header.magic = deltaMagic;
+        header.version = version;
+        header.dataType = uint32_t( type );
+        for( size_t i = 0; i < 3; ++i )
+            header.size[i] = size[i];
+        header.keyframeInterval = uint32_t( keyframeInterval );
+
+        // placeholder, rewritten on close
+        _write( &header, sizeof( header ));
+    }
+
+    ~Impl()
+    {
+        try
+        {
+            close();
+        }
+        catch( const std::exception& e )
+        {
+            LBERROR << e.what() << std::endl;
+        }
+    }
+
+    void writeFrame( const uint8_t* data )
+    {
+        if( !file.is_open( ))
+            LBTHROW( std::runtime_error( "Delta volume series is closed" ));
+
+        const size_t frame = index.size() / 2;
+        index.push_back( uint64_t( file.tellp( )));
+
+        if( frame % header.keyframeInterval == 0 )
+        {
+            _write( data, frameSize );
+            index.push_back( frameSize );
+            LBVERB << "Keyframe " << frame << ": " << frameSize << " bytes"
+                   << std::endl;
+        }
+        else
+        {
+            _encodeDelta( data, previous.data(), frameSize, encoded );
+            _write( encoded.data(), encoded.size( ));
+            index.push_back( encoded.size( ));
+            LBVERB << "Delta frame " << frame << ": " << encoded.size()
+                   << " bytes" << std::endl;
+        }
+        previous.assign( data, data + frameSize );
+    }
+
+    void close()
+    {
+        if( !file.is_open( ))
+            return;
+
+        // align the frame index for reading it from the memory map
+        const size_t padding = ( sizeof( uint64_t ) -
+                                 size_t( file.tellp( )) % sizeof( uint64_t )) %
+                               sizeof( uint64_t );
+        const uint64_t zero = 0;
+        _write( &zero, padding );
+
+        header.numFrames = uint32_t( index.size() / 2 );
+        header.indexOffset = uint64_t( file.tellp( ));
+        _write( index.data(), index.size() * sizeof( uint64_t ));
+        file.seekp( 0 );
+        _write( &header, sizeof( header ));
+        file.close();
+    }
+
+    void _write( const void* data, const size_t size )
+    {
+        file.write( static_cast< const char* >( data ), size );
+        if( !file.good( ))
+            LBTHROW( std::runtime_error( "Error while writing delta volume "
+                                         "series" ));
+    }
+
+    std::ofstream file;
+    DeltaHeader header;
+    const size_t frameSize;
+    std::vector< uint8_t > previous;
+    std::vector< uint8_t > encoded;
+    std::vector< uint64_t > index;
+};
+
+DeltaVolumeSeriesWriter::DeltaVolumeSeriesWriter( const std::string& filename,
+                                                  const Vector3ui& size,
+                                                  const size_t keyframeInterval,
+                                                  const VolumeDataType type )
+    : _impl( new Impl( filename, size, keyframeInterval, type ))
+{}
+
+DeltaVolumeSeriesWriter::~DeltaVolumeSeriesWriter()
+{}
+
+void DeltaVolumeSeriesWriter::setSpacing( const Vector3f& spacing )
+{
+    for( size_t i = 0; i < 3; ++i )
+        _impl->header.spacing[i] = spacing[i];
+}
+
+void DeltaVolumeSeriesWriter::setOrigin( const Vector3f& origin )
+{
+    for( size_t i = 0; i < 3; ++i )
+        _impl->header.origin[i] = origin[i];
+}
+
+void DeltaVolumeSeriesWriter::writeFrame( const void* data )
+{
+    _impl->writeFrame( static_cast< const uint8_t* >( data ));
+}
+
+void DeltaVolumeSeriesWriter::close()
+{
+    _impl->close();
+}
+
+class DeltaVolumeSeriesReader::Impl
+{
+public:
+    explicit Impl( const std::string& filename )
+        : file( filename )
+        , header( _getHeader( filename ))
+        , size( header->size[0], header->size[1], header->size[2] )
+        , spacing( header->spacing[0], header->spacing[1], header->spacing[2] )
+        , origin( header->origin[0], header->origin[1], header->origin[2] )
+        , frameSize( size_t( size[0] ) * size[1] * size[2] *
+                     getVolumeDataSize( VolumeDataType( header->dataType )))
+        , index( reinterpret_cast< const uint64_t* >(
+                     file.getAddress< uint8_t >() + header->indexOffset ))
+        , lastFrame( std::numeric_limits< size_t >::max( ))
+    {
+        for( size_t i = 0; i < header->numFrames; ++i )
+        {
+            if( index[ 2 * i ] + index[ 2 * i + 1 ] > header->indexOffset )
+                LBTHROW( std::runtime_error( "Corrupt frame index in " +
+                                             filename ));
+        }
+    }
+
+    const DeltaHeader* _getHeader( const std::string& filename ) const
+    {
+        const DeltaHeader* header_ = file.getAddress< DeltaHeader >();
+        if( !header_ || file.getSize() < sizeof( DeltaHeader ) ||
+            header_->magic != deltaMagic )
+        {
+            LBTHROW( std::runtime_error( filename +
+                                         " is not a delta volume series file"));
+        }
+        if( header_->version != version )
+            LBTHROW( std::runtime_error( "Bad version in " + filename ));
+        if( header_->keyframeInterval == 0 ||
+            file.getSize() < header_->indexOffset +
+                             header_->numFrames * 2 * sizeof( uint64_t ))
+        {
+            LBTHROW( std::runtime_error( "Truncated delta volume series " +
+                                         filename ));
+        }
+        return header_;
+    }
+
+    void readFrame( const size_t frame, uint8_t* data )
+    {
+        if( frame >= header->numFrames )
+            LBTHROW( std::runtime_error( "Frame " + std::to_string( frame ) +
+                                         " out of range of volume series" ));
+
+        // continue from the last read frame if it is on the way
+        const size_t keyframe = frame - frame % header->keyframeInterval;
+        size_t first = lastFrame + 1;
+        lastFrame = std::numeric_limits< size_t >::max();
+        if( first > frame + 1 || first <= keyframe )
+        {
+            if( index[ 2 * keyframe + 1 ] != frameSize )
+                LBTHROW( std::runtime_error( "Corrupt keyframe" ));
+            const uint8_t* src = _getFrame( keyframe );
+            current.assign( src, src + frameSize );
+            first = keyframe + 1;
+        }
+
+        for( size_t i = first; i <= frame; ++i )
+            _decodeDelta( _getFrame( i ), index[ 2 * i + 1 ], current.data(),
+                          frameSize );
+        lastFrame = frame;
+
+        ::memcpy( data, current.data(), frameSize );
+    }
+
+    const uint8_t* _getFrame( const size_t frame ) const
+    {
+        return file.getAddress< uint8_t >() + index[ 2 * frame ];
+    }
+
+    lunchbox::MemoryMap file;
+    const DeltaHeader* header;
+    const Vector3ui size;
+    const Vector3f spacing;
+    const Vector3f origin;
+    const size_t frameSize;
+    const uint64_t* index;
+    size_t lastFrame;
+    std::vector< uint8_t > current;
+};
+
+DeltaVolumeSeriesReader::DeltaVolumeSeriesReader( const std::string& filename )
+    : _impl( new Impl( filename ))
+{}
+
+DeltaVolumeSeriesReader::~DeltaVolumeSeriesReader()
+{}
+
+const Vector3ui& DeltaVolumeSeriesReader::getSize() const
+{
+    return _impl->size;
+}
+
+size_t DeltaVolumeSeriesReader::getNumFrames() const
+{
+    return _impl->header->numFrames;
+}
+
+size_t DeltaVolumeSeriesReader::getKeyframeInterval() const
+{
+    return _impl->header->keyframeInterval;
+}
+
+VolumeDataType DeltaVolumeSeriesReader::getDataType() const
+{
+    return VolumeDataType( _impl->header->dataType );
+}
+
+const Vector3f& DeltaVolumeSeriesReader::getSpacing() const
+{
+    return _impl->spacing;
+}
+
+const Vector3f& DeltaVolumeSeriesReader::getOrigin() const
+{
+    return _impl->origin;
+}
+
+void DeltaVolumeSeriesReader::readFrame( const size_t frame, void* data )
+{
+    _impl->readFrame( frame, static_cast< uint8_t* >( data ));
+}
+
+}
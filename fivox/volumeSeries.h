@@ -0,0 +1,269 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FIVOX_VOLUMESERIES_H
+#define FIVOX_VOLUMESERIES_H
+
+#include <fivox/api.h>
+#include <fivox/types.h>
+
+namespace fivox
+{
+
+/** @return the VolumeDataType of the given voxel type */
+template< typename T > VolumeDataType getVolumeDataType();
+template<> inline VolumeDataType getVolumeDataType< uint8_t >()
+    { return VolumeDataType::uint8; }
+template<> inline VolumeDataType getVolumeDataType< uint16_t >()
+    { return VolumeDataType::uint16; }
+template<> inline VolumeDataType getVolumeDataType< uint32_t >()
+    { return VolumeDataType::uint32; }
+template<> inline VolumeDataType getVolumeDataType< float >()
+    { return VolumeDataType::float32; }
+
+/** @return the size in bytes of one voxel of the given data type */
+FIVOX_API size_t getVolumeDataSize( VolumeDataType type );
+
+/**
+ * Writes a time series of volumes into one chunked file.
+ *
+ * The volume is split into fixed-size chunks, and the chunks of all frames of
+ * the same spatial chunk are stored next to each other. Reading a region over
+ * time thus accesses a few contiguous ranges of the file. The file is
+ * preallocated and memory-mapped, so frames can be written in any order.
+ */
+class VolumeSeriesWriter
+{
+public:
+    /**
+     * Create a new volume series file, overwriting any existing one.
+     *
+     * @param filename the name of the file to create
+     * @param size the number of voxels of each volume in each dimension
+     * @param numFrames the number of frames of the series
+     * @param chunkSize the number of voxels of a chunk in each dimension
+     * @param type the data type of the voxels
+     * @throw std::runtime_error if the file cannot be created
+     */
+    FIVOX_API VolumeSeriesWriter( const std::string& filename,
+                                  const Vector3ui& size, size_t numFrames,
+                                  const Vector3ui& chunkSize,
+                                  VolumeDataType type );
+    FIVOX_API ~VolumeSeriesWriter();
+
+    /** Set the spacing between voxels, in micrometers. */
+    FIVOX_API void setSpacing( const Vector3f& spacing );
+
+    /** Set the position of the first voxel, in micrometers. */
+    FIVOX_API void setOrigin( const Vector3f& origin );
+
+    /**
+     * Write the volume of one frame.
+     *
+     * @param frame the frame index, relative to the start of the series
+     * @param data the voxels of the volume, x being the fastest dimension
+     * @throw std::runtime_error if the frame is out of range
+     */
+    FIVOX_API void writeFrame( size_t frame, const void* data );
+
+private:
+    VolumeSeriesWriter( const VolumeSeriesWriter& ) = delete;
+    VolumeSeriesWriter& operator=( const VolumeSeriesWriter& ) = delete;
+
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+/** Reads regions of a volume series written by VolumeSeriesWriter. */
+class VolumeSeriesReader
+{
+public:
+    /**
+     * Open a volume series file.
+     *
+     * @param filename the name of the file to read
+     * @throw std::runtime_error if the file is not a valid volume series
+     */
+    FIVOX_API explicit VolumeSeriesReader( const std::string& filename );
+    FIVOX_API ~VolumeSeriesReader();
+
+    /** @return the number of voxels of each volume in each dimension */
+    FIVOX_API const Vector3ui& getSize() const;
+
+    /** @return the number of voxels of a chunk in each dimension */
+    FIVOX_API const Vector3ui& getChunkSize() const;
+
+    /** @return the number of frames of the series */
+    FIVOX_API size_t getNumFrames() const;
+
+    /** @return the data type of the voxels */
+    FIVOX_API VolumeDataType getDataType() const;
+
+    /** @return the spacing between voxels, in micrometers */
+    FIVOX_API const Vector3f& getSpacing() const;
+
+    /** @return the position of the first voxel, in micrometers */
+    FIVOX_API const Vector3f& getOrigin() const;
+
+    /** @return true if the given frame has been written */
+    FIVOX_API bool hasFrame( size_t frame ) const;
+
+    /**
+     * Read the voxels of a region over a range of frames.
+     *
+     * @param begin the first voxel of the region
+     * @param size the number of voxels of the region in each dimension
+     * @param frames the frame range [start end) to read
+     * @param data the destination of the voxels, which is filled with x being
+     *             the fastest and the frame the slowest dimension
+     * @throw std::runtime_error if the region or the frames are out of range
+     */
+    FIVOX_API void read( const Vector3ui& begin, const Vector3ui& size,
+                         const Vector2ui& frames, void* data ) const;
+
+    /**
+     * Read the full volume of one frame.
+     *
+     * @param frame the frame index, relative to the start of the series
+     * @param data the destination of the voxels, x being the fastest dimension
+     * @throw std::runtime_error if the frame is out of range
+     */
+    FIVOX_API void readFrame( size_t frame, void* data ) const;
+
+private:
+    VolumeSeriesReader( const VolumeSeriesReader& ) = delete;
+    VolumeSeriesReader& operator=( const VolumeSeriesReader& ) = delete;
+
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+/**
+ * Writes a time series of volumes as keyframes and deltas into one file.
+ *
+ * Every keyframe interval a frame is stored completely. The other frames are
+ * stored as the run-length encoded XOR with their previous frame, which is
+ * lossless and very compact for voxels which did not change. Frames have to be
+ * written in order; the frame index is written when the file is closed.
+ */
+class DeltaVolumeSeriesWriter
+{
+public:
+    /**
+     * Create a new delta volume series file, overwriting any existing one.
+     *
+     * @param filename the name of the file to create
+     * @param size the number of voxels of each volume in each dimension
+     * @param keyframeInterval the number of frames between two keyframes
+     * @param type the data type of the voxels
+     * @throw std::runtime_error if the file cannot be created
+     */
+    FIVOX_API DeltaVolumeSeriesWriter( const std::string& filename,
+                                       const Vector3ui& size,
+                                       size_t keyframeInterval,
+                                       VolumeDataType type );
+
+    /** Close the file if still open. */
+    FIVOX_API ~DeltaVolumeSeriesWriter();
+
+    /** Set the spacing between voxels, in micrometers. */
+    FIVOX_API void setSpacing( const Vector3f& spacing );
+
+    /** Set the position of the first voxel, in micrometers. */
+    FIVOX_API void setOrigin( const Vector3f& origin );
+
+    /**
+     * Append the volume of the next frame.
+     *
+     * @param data the voxels of the volume, x being the fastest dimension
+     * @throw std::runtime_error if the frame could not be written
+     */
+    FIVOX_API void writeFrame( const void* data );
+
+    /**
+     * Write the frame index and the header, and close the file.
+     *
+     * @throw std::runtime_error if the file could not be written
+     */
+    FIVOX_API void close();
+
+private:
+    DeltaVolumeSeriesWriter( const DeltaVolumeSeriesWriter& ) = delete;
+    DeltaVolumeSeriesWriter& operator=( const DeltaVolumeSeriesWriter& ) =
+        delete;
+
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+/** Reads frames of a series written by DeltaVolumeSeriesWriter. */
+class DeltaVolumeSeriesReader
+{
+public:
+    /**
+     * Open a delta volume series file.
+     *
+     * @param filename the name of the file to read
+     * @throw std::runtime_error if the file is not a valid delta volume series
+     */
+    FIVOX_API explicit DeltaVolumeSeriesReader( const std::string& filename );
+    FIVOX_API ~DeltaVolumeSeriesReader();
+
+    /** @return the number of voxels of each volume in each dimension */
+    FIVOX_API const Vector3ui& getSize() const;
+
+    /** @return the number of frames of the series */
+    FIVOX_API size_t getNumFrames() const;
+
+    /** @return the number of frames between two keyframes */
+    FIVOX_API size_t getKeyframeInterval() const;
+
+    /** @return the data type of the voxels */
+    FIVOX_API VolumeDataType getDataType() const;
+
+    /** @return the spacing between voxels, in micrometers */
+    FIVOX_API const Vector3f& getSpacing() const;
+
+    /** @return the position of the first voxel, in micrometers */
+    FIVOX_API const Vector3f& getOrigin() const;
+
+    /**
+     * Reconstruct the full volume of one frame.
+     *
+     * Decodes from the previous keyframe, or from the last read frame when
+     * reading frames in increasing order within a keyframe interval.
+     *
+     * @param frame the frame index, relative to the start of the series
+     * @param data the destination of the voxels, x being the fastest dimension
+     * @throw std::runtime_error if the frame is out of range or corrupt
+     */
+    FIVOX_API void readFrame( size_t frame, void* data );
+
+private:
+    DeltaVolumeSeriesReader( const DeltaVolumeSeriesReader& ) = delete;
+    DeltaVolumeSeriesReader& operator=( const DeltaVolumeSeriesReader& ) =
+        delete;
+
+    class Impl;
+    std::unique_ptr< Impl > _impl;
+};
+
+}
+
+#endif
@@ -0,0 +1,156 @@
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FIVOX_VOLUMESTATISTICS_H
+#define FIVOX_VOLUMESTATISTICS_H
+
+#include <fivox/types.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace fivox
+{
+/**
+ * Streaming statistics of voxel values: minimum, maximum and an optional
+ * histogram for percentiles.
+ *
+ * The histogram has one bin per value of the 16 most significant bits of the
+ * float representation, giving a relative precision of 2^-7 over the whole
+ * float range without knowing the data range upfront. Statistics gathered by
+ * different threads can be merged.
+ */
+class VolumeStatistics
+{
+public:
+    /** @param histogram enable gathering a histogram for getPercentile() */
+    explicit VolumeStatistics( const bool histogram = false )
+    {
+        reset( histogram );
+    }
+
+    /** Clear all statistics, enabling the histogram or not. */
+    void reset( const bool histogram )
+    {
+        _min = std::numeric_limits< float >::max();
+        _max = -std::numeric_limits< float >::max();
+        _count = 0;
+        _histogram.assign( histogram ? _numBins : 0, 0 );
+    }
+
+    /** Add one value; NaNs are ignored. */
+    void add( const float value )
+    {
+        if( value != value )
+            return;
+        _min = std::min( _min, value );
+        _max = std::max( _max, value );
+        ++_count;
+        if( !_histogram.empty( ))
+            ++_histogram[ _getBin( value ) ];
+    }
+
+    /** Add the statistics of another set of values. */
+    void merge( const VolumeStatistics& other )
+    {
+        _min = std::min( _min, other._min );
+        _max = std::max( _max, other._max );
+        _count += other._count;
+        if( _histogram.empty( ))
+            return;
+        if( other._histogram.empty( ))
+        {
+            _histogram.clear(); // incomplete, percentiles not available
+            return;
+        }
+        for( size_t i = 0; i < _numBins; ++i )
+            _histogram[i] += other._histogram[i];
+    }
+
+    /** @return the number of values added. */
+    size_t getCount() const { return _count; }
+
+    /** @return the minimum value, or 0 if empty. */
+    float getMin() const { return _count > 0 ? _min : 0.f; }
+
+    /** @return the maximum value, or 0 if empty. */
+    float getMax() const { return _count > 0 ? _max : 0.f; }
+
+    /** @return the range [min, max] of the values. */
+    Vector2f getRange() const { return Vector2f( getMin(), getMax( )); }
+
+    /** @return true if a histogram is available for getPercentile(). */
+    bool hasHistogram() const { return !_histogram.empty(); }
+
+    /**
+     * @param percentile the percentage [0, 100] of values below the result
+     * @return the value at the given percentile, with a relative precision of
+     *         2^-7, or the minimum / maximum if no histogram is available.
+     */
+    float getPercentile( const float percentile ) const
+    {
+        if( percentile <= 0.f || _count == 0 )
+            return getMin();
+        if( percentile >= 100.f || _histogram.empty( ))
+            return percentile < 50.f ? getMin() : getMax();
+
+        const uint64_t target = std::ceil( percentile / 100.f * _count );
+        uint64_t sum = 0;
+        for( size_t i = 0; i < _numBins; ++i )
+        {
+            sum += _histogram[i];
+            if( sum >= target )
+                return std::max( _min, std::min( _max, _getValue( i )));
+        }
+        return _max;
+    }
+
+private:
+    static const size_t _numBins = 1 << 16;
+
+    // map the float bits to unsigned integers of the same order
+    static uint32_t _getBin( const float value )
+    {
+        uint32_t bits;
+        ::memcpy( &bits, &value, sizeof( bits ));
+        bits = ( bits & 0x80000000u ) ? ~bits : bits | 0x80000000u;
+        return bits >> 16;
+    }
+
+    // the smallest value of the given bin
+    static float _getValue( const size_t bin )
+    {
+        uint32_t bits = uint32_t( bin ) << 16;
+        bits = ( bits & 0x80000000u ) ? bits & 0x7fffffffu : ~bits;
+        float value;
+        ::memcpy( &value, &bits, sizeof( value ));
+        return value;
+    }
+
+    float _min;
+    float _max;
+    size_t _count;
+    std::vector< uint64_t > _histogram;
+};
+}
+
+#endif
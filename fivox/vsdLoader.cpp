@@ -31,7 +31,9 @@
 #include <brain/neuron/section.h>
 #include <brain/neuron/soma.h>
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 namespace fivox
 {
@@ -46,18 +48,14 @@ public:
         , _voltageReport( params.getConfig().getReportSource( params.getReport( )),
                           brion::MODE_READ, _gids )
         , _areaReport( URI( params.getAreas( )), brion::MODE_READ, _gids )
+        , _frameLoader( _voltageReport )
         , _restingPotential( 0.f )
         , _areaMultiplier( 0.f )
         , _spikeFilter( false )
         , _apThreshold( 0.f )
         , _interpolate( false )
     {
-        LBINFO << "Loading " << _gids.size() << " morphologies..." << std::endl;
-        const auto morphologies = _circuit.loadMorphologies(
-            _gids, brain::Circuit::Coordinates::global );
-
-        LBINFO << "Creating events..." << std::endl;
-        helpers::addCompartmentEvents( morphologies, _voltageReport, _output );
+        helpers::loadCompartmentEvents( params, _voltageReport, _output );
 
         LBINFO << "Loading areas..." << std::endl;
         _areas = _areaReport.loadFrame( 0.f );
@@ -65,8 +63,7 @@ public:
 
     ssize_t load()
     {
-        brion::floatsPtr voltages =
-                _voltageReport.loadFrame( _output.getCurrentTime( ));
+        brion::floatsPtr voltages = _frameLoader.load( _output );
         if( !voltages )
             return -1;
 
@@ -74,21 +71,36 @@ public:
             LBTHROW( std::runtime_error( "The number of compartments in the "
                                          "voltage report doesn't match the "
                                          "number of areas" ));
-        for( size_t i = 0; i != voltages->size(); ++i )
-        {
-            const float voltage = ( *voltages )[i];
-            _updateEventValue( i, _spikeFilter ? std::min(voltage, _apThreshold )
-                                               : voltage, ( *_areas )[i] );
-        }
-        return voltages->size();
+        const size_t size = voltages->size();
+        if( _coefficients.size() != size )
+            _computeCoefficients();
+        if( size == 0 )
+            return 0;
+
+        // ( voltage - restingPotential + areaMultiplier ) * coefficient, in
+        // one pass the compiler can vectorize
+        const float offset = _areaMultiplier - _restingPotential;
+        const float threshold = _spikeFilter ?
+                                _apThreshold :
+                                std::numeric_limits< float >::infinity();
+        const float* __restrict__ voltage = voltages->data();
+        const float* __restrict__ coefficient = _coefficients.data();
+        float* __restrict__ value = &_output[0];
+        for( size_t i = 0; i < size; ++i )
+            value[i] = ( std::min( voltage[i], threshold ) + offset ) *
+                       coefficient[i];
+        return size;
     }
 
-    void _updateEventValue( const size_t index, const float voltage,
-                            const float area )
+    // area times attenuation of each event, which do not change over time
+    void _computeCoefficients()
     {
-        const float positionY = _output.getPositionsY()[index];
-        _output[index] = ( voltage - _restingPotential + _areaMultiplier ) *
-                         area * _curve.getAttenuation( positionY, _interpolate);
+        const size_t size = _areas->size();
+        const float* positionsY = _output.getPositionsY();
+        _coefficients.resize( size );
+        for( size_t i = 0; i < size; ++i )
+            _coefficients[i] = ( *_areas )[i] *
+                _curve.getAttenuation( positionsY[i], _interpolate );
     }
 
     EventSource& _output;
@@ -97,8 +109,10 @@ public:
 
     brion::CompartmentReport _voltageReport;
     brion::CompartmentReport _areaReport;
+    helpers::FrameLoader _frameLoader;
     brion::floatsPtr _areas;
     AttenuationCurve _curve;
+    brion::floats _coefficients; // empty if outdated
 
     AABBf _bboxSomas; // bounding box of the somas
     float _restingPotential; // resting potential (mV)
@@ -123,6 +137,8 @@ VSDLoader::~VSDLoader()
 void VSDLoader::setCurve( const AttenuationCurve& curve )
 {
     _impl->_curve = curve;
+    _impl->_coefficients.clear();
+    _invalidateFrames();
 }
 
 const brion::GIDSet& VSDLoader::getGIDs() const
@@ -138,26 +154,32 @@ const brion::Vector3fs VSDLoader::getSomaPositions() const
 void VSDLoader::setRestingPotential( const float millivolts )
 {
     _impl->_restingPotential = millivolts;
+    _invalidateFrames();
 }
 
 void VSDLoader::setAreaMultiplier( const float factor )
 {
     _impl->_areaMultiplier = factor;
+    _invalidateFrames();
 }
 
 void VSDLoader::setSpikeFilter( const bool enable )
 {
     _impl->_spikeFilter = enable;
+    _invalidateFrames();
 }
 
 void VSDLoader::setApThreshold( const float apThreshold )
 {
     _impl->_apThreshold = apThreshold;
+    _invalidateFrames();
 }
 
 void VSDLoader::setInterpolation( const bool interpolate )
 {
     _impl->_interpolate = interpolate;
+    _impl->_coefficients.clear();
+    _invalidateFrames();
 }
 
 Vector2f VSDLoader::_getTimeRange() const
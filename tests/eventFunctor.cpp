@@ -35,6 +35,9 @@
 #include <fivox/eventSource.h>
 #include <fivox/functorImageSource.h>
 #include <fivox/eventFunctor.h>
+#include <fivox/quantizeFunctor.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkIntensityWindowingImageFilter.h>
 #include <itkTimeProbe.h>
 #include <iomanip>
 
@@ -61,6 +64,20 @@ public:
     }
 };
 
+class RampFunctor : public fivox::EventFunctor< fivox::FloatVolume >
+{
+    typedef fivox::EventFunctor< fivox::FloatVolume > Super;
+public:
+    RampFunctor() : Super() {}
+    virtual ~RampFunctor() {}
+
+    float operator()( const Super::TPoint& point,
+                      const Super::TSpacing& ) const
+    {
+        return point[0] * 0.37f + point[1] * 0.01f - 3.f;
+    }
+};
+
 template< typename T, size_t dim >
 inline void _testEventFunctor( const size_t size )
 {
@@ -116,3 +133,46 @@ BOOST_AUTO_TEST_CASE(EventFunctor)
         }
     }
 }
+
+BOOST_AUTO_TEST_CASE(QuantizeFunctor)
+{
+    const size_t size = 64;
+    const fivox::Vector2f inputRange( -2.f, 15.f );
+    auto ramp = std::make_shared< RampFunctor >();
+
+    // reference: sample floats, then window into bytes
+    typedef fivox::FunctorImageSource< fivox::FloatVolume > FloatSource;
+    FloatSource::Pointer floatSource = FloatSource::New();
+    _setSize< fivox::FloatVolume >( floatSource->GetOutput(), size );
+    floatSource->setFunctor( ramp );
+
+    typedef itk::IntensityWindowingImageFilter< fivox::FloatVolume,
+                                                fivox::ByteVolume > Windowing;
+    Windowing::Pointer windowing = Windowing::New();
+    windowing->SetInput( floatSource->GetOutput( ));
+    windowing->SetWindowMinimum( inputRange[0] );
+    windowing->SetWindowMaximum( inputRange[1] );
+    windowing->SetOutputMinimum( 0 );
+    windowing->SetOutputMaximum( 255 );
+    windowing->Update();
+
+    // quantized while sampling
+    typedef fivox::FunctorImageSource< fivox::ByteVolume > ByteSource;
+    ByteSource::Pointer byteSource = ByteSource::New();
+    _setSize< fivox::ByteVolume >( byteSource->GetOutput(), size );
+    byteSource->setFunctor(
+        std::make_shared< fivox::QuantizeFunctor< fivox::ByteVolume >>(
+            ramp, inputRange ));
+    byteSource->Update();
+
+    typedef itk::ImageRegionConstIterator< fivox::ByteVolume > Iterator;
+    Iterator expected( windowing->GetOutput(),
+                       windowing->GetOutput()->GetLargestPossibleRegion( ));
+    Iterator actual( byteSource->GetOutput(),
+                     byteSource->GetOutput()->GetLargestPossibleRegion( ));
+    size_t numDifferent = 0;
+    for( ; !expected.IsAtEnd(); ++expected, ++actual )
+        if( expected.Get() != actual.Get( ))
+            ++numDifferent;
+    BOOST_CHECK_EQUAL( numDifferent, size_t( 0 ));
+}
@@ -58,6 +58,7 @@
 #include <lunchbox/sleep.h>
 #include <lunchbox/pluginRegisterer.h>
 
+#include <future>
 #include <iomanip>
 
 #define STARTUP_DELAY 250
@@ -249,6 +250,25 @@ BOOST_AUTO_TEST_CASE( fivoxVoltages_source )
                 -0.062685228640475543, vmml::Vector2ui( 0, 100 ));
 }
 
+BOOST_AUTO_TEST_CASE( fivoxVoltages_geometryCache_source )
+{
+    const boost::filesystem::path cache =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    const fivox::URI uri( "fivoxcompartments://?geometryCache=" +
+                          cache.string( ));
+
+    // the first run saves the events, the second one loads them from there
+    testSource( uri, 5.455078125f, -0.062685228640475543,
+                vmml::Vector2ui( 0, 100 ));
+    BOOST_CHECK_EQUAL( std::distance(
+                           boost::filesystem::directory_iterator( cache ),
+                           boost::filesystem::directory_iterator( )), 1 );
+    testSource( uri, 5.455078125f, -0.062685228640475543,
+                vmml::Vector2ui( 0, 100 ));
+    boost::filesystem::remove_all( cache );
+}
+
 BOOST_AUTO_TEST_CASE( fivoxSomas_source )
 {
     // Soma report 'somas' (binary) contains timestamps
@@ -281,6 +301,54 @@ BOOST_AUTO_TEST_CASE( fivoxSynapses_source )
                 437.92578125f, vmml::Vector2ui( 0, 1 ));
 }
 
+BOOST_AUTO_TEST_CASE( fivoxSynapses_cache_source )
+{
+    const boost::filesystem::path cache =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    const fivox::URI uri( "fivoxsynapses://?target=Column&synapseCache=" +
+                          cache.string( ));
+
+    // the first run saves the positions, the second one reads them from there
+    testSource( uri, 7.42578125f, 437.92578125f, vmml::Vector2ui( 0, 1 ));
+    BOOST_CHECK_EQUAL( std::distance(
+                           boost::filesystem::directory_iterator( cache ),
+                           boost::filesystem::directory_iterator( )), 1 );
+    testSource( uri, 7.42578125f, 437.92578125f, vmml::Vector2ui( 0, 1 ));
+    boost::filesystem::remove_all( cache );
+}
+
+BOOST_AUTO_TEST_CASE( fivoxSynapses_readAhead )
+{
+    const fivox::URIHandler params(
+        fivox::URI( "fivoxsynapses://?target=Column" ));
+    fivox::SynapseLoader loader( params );
+    const size_t numChunks = loader.getNumChunks();
+    const ssize_t total = loader.load( 0, numChunks );
+    BOOST_CHECK_GT( total, 0 );
+
+    const fivox::URIHandler readAheadParams(
+        fivox::URI( "fivoxsynapses://?target=Column&synapseReads=4" ));
+    fivox::SynapseLoader readAhead( readAheadParams );
+
+    // an aborted pass does not leak its reads into the next one
+    BOOST_CHECK_GT( numChunks, 3 );
+    readAhead.load( 0, 3 );
+
+    // passes in growing batches, like EventValueSummationImageSource
+    for( size_t pass = 0; pass < 2; ++pass )
+    {
+        ssize_t loaded = 0;
+        size_t batchSize = 1;
+        for( size_t i = 0; i < numChunks; i += batchSize, ++batchSize )
+        {
+            batchSize = std::min( batchSize, numChunks - i );
+            loaded += readAhead.load( i, batchSize );
+        }
+        BOOST_CHECK_EQUAL( loaded, total );
+    }
+}
+
 BOOST_AUTO_TEST_CASE( fivoxVSD_source )
 {
     testSource( fivox::URI( "fivoxvsd://?target=allmini50" ),
@@ -289,6 +357,220 @@ BOOST_AUTO_TEST_CASE( fivoxVSD_source )
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_CASE( eventSource_snapshot )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://" ));
+    fivox::GenericLoader loader( params );
+    loader.setTime( 0.f );
+    BOOST_CHECK_EQUAL( loader.load(), 7 );
+
+    const fivox::EventSourcePtr snapshot = loader.createSnapshot();
+    BOOST_CHECK_EQUAL( snapshot->getNumEvents(), loader.getNumEvents( ));
+    BOOST_CHECK_EQUAL( snapshot->getFrameRange(), loader.getFrameRange( ));
+    BOOST_CHECK_EQUAL( snapshot->getPositionsX(), loader.getPositionsX( ));
+    BOOST_CHECK_EQUAL( snapshot->getRadii(), loader.getRadii( ));
+
+    // the snapshot keeps the values while the loader moves on
+    loader.setTime( 5.f );
+    BOOST_CHECK_EQUAL( loader.load(), 7 );
+    BOOST_CHECK_EQUAL( snapshot->load(), 7 );
+    for( size_t i = 0; i < loader.getNumEvents(); ++i )
+    {
+        BOOST_CHECK_EQUAL( snapshot->getValues()[i], i + 1.f );
+        BOOST_CHECK_EQUAL( loader.getValues()[i], i + 6.f );
+    }
+
+    // pipelines sharing the snapshot load it concurrently
+    std::vector< std::future< bool >> loads;
+    for( size_t i = 0; i < 4; ++i )
+        loads.push_back( std::async( std::launch::async, [snapshot]
+        {
+            bool loaded = true;
+            for( size_t j = 0; j < 100; ++j )
+                loaded = loaded && snapshot->load() == 7;
+            return loaded;
+        }));
+    for( std::future< bool >& load : loads )
+        BOOST_CHECK( load.get( ));
+    for( size_t i = 0; i < snapshot->getNumEvents(); ++i )
+        BOOST_CHECK_EQUAL( snapshot->getValues()[i], i + 1.f );
+
+    // modified positions are copied on write
+    loader.update( 0, fivox::Vector3f( 1.f, 2.f, 3.f ), 1.f );
+    BOOST_CHECK_NE( snapshot->getPositionsX(), loader.getPositionsX( ));
+    BOOST_CHECK_EQUAL( snapshot->getPositionsX()[0], 0.f );
+    BOOST_CHECK_EQUAL( loader.getPositionsX()[0], 1.f );
+    BOOST_CHECK_EQUAL( snapshot->getPositionsY()[1], 10.f );
+    BOOST_CHECK_EQUAL( loader.getPositionsY()[1], 10.f );
+}
+
+namespace
+{
+class CountingLoader : public fivox::EventSource
+{
+public:
+    explicit CountingLoader( const fivox::URIHandler& params )
+        : fivox::EventSource( params )
+        , numLoads( 0 )
+    {
+        resize( 2 );
+        setDt( 1.f );
+    }
+
+    size_t numLoads;
+
+    void invalidate() { _invalidateFrames(); }
+
+private:
+    fivox::Vector2f _getTimeRange() const final
+        { return fivox::Vector2f( 0.f, 10.f ); }
+
+    ssize_t _load( size_t, size_t ) final
+    {
+        ++numLoads;
+        (*this)[0] = getCurrentTime();
+        (*this)[1] = getCurrentTime() * 2.f;
+        return getNumEvents();
+    }
+
+    fivox::SourceType _getType() const final
+        { return fivox::SourceType::frame; }
+    size_t _getNumChunks() const final { return 2; }
+};
+}
+
+BOOST_AUTO_TEST_CASE( eventSource_frameCache )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://?frameCache=2" ));
+    CountingLoader loader( params );
+    loader.setTime( 1.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 1 );
+
+    // recent frames are restored without loading them
+    loader.setTime( 2.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    loader.setTime( 1.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 2 );
+    BOOST_CHECK_EQUAL( loader.getValues()[1], 2.f );
+
+    // the least recently used frame is evicted
+    loader.setTime( 3.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    loader.setTime( 1.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 3 );
+    loader.setTime( 2.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 4 );
+    BOOST_CHECK_EQUAL( loader.getValues()[1], 4.f );
+
+    // partial loads do not hold a complete frame, which is restored
+    BOOST_CHECK_EQUAL( loader.load( 0, 1 ), 2 );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 5 );
+
+    // modified events invalidate all frames
+    loader.update( 0, fivox::Vector3f( 1.f, 2.f, 3.f ), 1.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    loader.setTime( 3.f );
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 7 );
+
+    // values modified through operator[] are restored
+    loader[1] = 42.f;
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 7 );
+    BOOST_CHECK_EQUAL( loader.getValues()[1], 6.f );
+
+    // invalidated frames are loaded again, e.g. after a parameter change
+    loader.invalidate();
+    BOOST_CHECK_EQUAL( loader.load(), 2 );
+    BOOST_CHECK_EQUAL( loader.numLoads, 8 );
+}
+
+BOOST_AUTO_TEST_CASE( eventSource_fingerprint )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://" ));
+    fivox::GenericLoader loader( params );
+    loader.setTime( 0.f );
+    BOOST_CHECK_EQUAL( loader.load(), 7 );
+
+    // the first two events along y
+    const fivox::AABBf area( fivox::Vector3f( -1.f ),
+                             fivox::Vector3f( 1.f, 15.f, 1.f ));
+    const fivox::AABBf empty( fivox::Vector3f( 100.f ),
+                              fivox::Vector3f( 200.f ));
+    BOOST_CHECK_EQUAL( loader.getFingerprint( empty ), uint64_t( 0 ));
+    const uint64_t fingerprint = loader.getFingerprint( area );
+    BOOST_CHECK_NE( fingerprint, uint64_t( 0 ));
+
+    // only values in the area change the fingerprint
+    loader[4] = 42.f;
+    BOOST_CHECK_EQUAL( loader.getFingerprint( area ), fingerprint );
+    loader[1] = 42.f;
+    BOOST_CHECK_NE( loader.getFingerprint( area ), fingerprint );
+    loader[1] = 2.f;
+    BOOST_CHECK_EQUAL( loader.getFingerprint( area ), fingerprint );
+}
+
+BOOST_AUTO_TEST_CASE( eventSource_rangeUpdate )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://" ));
+    fivox::GenericLoader loader( params );
+    loader.resize( 4 );
+
+    const float posX[] = { 1.f, -2.f, 3.f };
+    const float posY[] = { 4.f, 5.f, -6.f };
+    const float posZ[] = { 7.f, 8.f, 9.f };
+    loader.update( 1, 3, posX, posY, posZ, 2.f, 3.f );
+    for( size_t i = 0; i < 3; ++i )
+    {
+        BOOST_CHECK_EQUAL( loader.getPositionsX()[i + 1], posX[i] );
+        BOOST_CHECK_EQUAL( loader.getPositionsY()[i + 1], posY[i] );
+        BOOST_CHECK_EQUAL( loader.getPositionsZ()[i + 1], posZ[i] );
+        BOOST_CHECK_EQUAL( loader.getRadii()[i + 1], 0.5f );
+        BOOST_CHECK_EQUAL( loader.getValues()[i + 1], 3.f );
+    }
+    BOOST_CHECK( loader.getBoundingBox().isIn(
+                     fivox::Vector3f( -2.f, -6.f, 7.f )));
+    BOOST_CHECK( loader.getBoundingBox().isIn(
+                     fivox::Vector3f( 3.f, 5.f, 9.f )));
+
+    // ranges beyond the events are ignored
+    loader.update( 2, 3, posX, posY, posZ, 2.f, 1.f );
+    BOOST_CHECK_EQUAL( loader.getValues()[2], 3.f );
+}
+
+BOOST_AUTO_TEST_CASE( eventSource_proxies )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://" ));
+    fivox::GenericLoader loader( params );
+    loader.setTime( 0.f );
+    BOOST_CHECK_EQUAL( loader.load(), 7 );
+    BOOST_CHECK_THROW( loader.createProxies( 0.f ), std::invalid_argument );
+
+    // all events in one cell
+    fivox::EventSourcePtr proxies = loader.createProxies( 100.f );
+    BOOST_CHECK_EQUAL( proxies->getNumEvents(), 1 );
+    BOOST_CHECK_EQUAL( proxies->getValues()[0], 28.f );
+    BOOST_CHECK_CLOSE( proxies->getRadii()[0], 1.f / 50.f, 0.001f );
+    BOOST_CHECK_CLOSE( proxies->getPositionsY()[0], 444.f / 28.f, 0.001f );
+
+    // events along y in separate cells, the first cell has three events
+    proxies = loader.createProxies( 10.f );
+    BOOST_CHECK_EQUAL( proxies->getNumEvents(), 5 );
+    BOOST_CHECK_EQUAL( proxies->getBoundingBox(), loader.getBoundingBox( ));
+    float sum = 0.f;
+    for( size_t i = 0; i < proxies->getNumEvents(); ++i )
+        sum += proxies->getValues()[i];
+    BOOST_CHECK_EQUAL( sum, 28.f );
+    BOOST_CHECK_EQUAL( proxies->getValues()[0], 14.f );
+    BOOST_CHECK_CLOSE( proxies->getPositionsX()[0], 53.f / 14.f, 0.001f );
+}
+
 #if FIVOX_USE_MONSTEER
 
 BOOST_AUTO_TEST_CASE( fivoxSpikes_stream_source_frame_range )
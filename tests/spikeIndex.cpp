@@ -0,0 +1,120 @@
+
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Eyescale Software GmbH nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE SpikeIndex
+
+#include "test.h"
+#include <fivox/spikeIndex.h>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace
+{
+// NEST spike report lines: gid time
+const std::pair< uint32_t, float > _spikes[] = {
+    { 1, 0.5f }, { 2, 4.f }, { 1, 1.5f }, { 3, 2.f }, { 2, 2.f },
+    { 3, 9.75f }, { 1, 5.25f }, { 2, 3.f }, { 3, 0.5f }, { 1, 8.f }
+};
+const size_t _numSpikes = sizeof( _spikes ) / sizeof( _spikes[0] );
+
+size_t _countSpikes( const float start, const float end )
+{
+    size_t count = 0;
+    for( const auto& spike : _spikes )
+        if( spike.second >= start && spike.second < end )
+            ++count;
+    return count;
+}
+
+void _checkIndex( const fivox::SpikeIndex& index )
+{
+    BOOST_CHECK_EQUAL( index.getNumSpikes(), _numSpikes );
+    BOOST_CHECK_EQUAL( index.getEndTime(), 9.75f );
+
+    for( size_t i = 1; i < index.getNumSpikes(); ++i )
+        BOOST_CHECK_LE( index.getTimes()[i - 1], index.getTimes()[i] );
+
+    const float windows[][2] = { { 0.f, 1.f }, { 0.5f, 2.f }, { 2.f, 2.5f },
+                                 { 1.f, 10.f }, { -5.f, 0.5f }, { 10.f, 20.f },
+                                 { 4.f, 3.f }};
+    for( const auto& window : windows )
+    {
+        const auto range = index.find( window[0], window[1] );
+        BOOST_CHECK_LE( range.first, range.second );
+        BOOST_CHECK_EQUAL( range.second - range.first,
+                           _countSpikes( window[0], window[1] ));
+        for( size_t i = range.first; i < range.second; ++i )
+        {
+            BOOST_CHECK_GE( index.getTimes()[i], window[0] );
+            BOOST_CHECK_LT( index.getTimes()[i], window[1] );
+        }
+    }
+
+    const auto range = index.find( 2.f, 2.5f );
+    BOOST_CHECK_EQUAL( index.getGIDs()[range.first] +
+                       index.getGIDs()[range.first + 1], 5 );
+}
+}
+
+BOOST_AUTO_TEST_CASE( SpikeIndexBuildAndMap )
+{
+    namespace fs = boost::filesystem;
+    const fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories( directory );
+    const std::string report = ( directory / "spikes.gdf" ).string();
+    {
+        std::ofstream file( report );
+        for( const auto& spike : _spikes )
+            file << spike.first << " " << spike.second << std::endl;
+    }
+
+    // built from the report and saved next to it
+    {
+        const fivox::SpikeIndex index(( fivox::URI( report )));
+        _checkIndex( index );
+    }
+    BOOST_CHECK( fs::exists( report + ".fivoxindex" ));
+
+    // mapped from the saved index
+    {
+        const fivox::SpikeIndex index(( fivox::URI( report )));
+        _checkIndex( index );
+    }
+
+    fs::remove_all( directory );
+}
+
+BOOST_AUTO_TEST_CASE( SpikeIndexInvalidReport )
+{
+    BOOST_CHECK_THROW( fivox::SpikeIndex( fivox::URI( "/doesnotexist.gdf" )),
+                       std::runtime_error );
+}
@@ -57,6 +57,12 @@ BOOST_AUTO_TEST_CASE(compartment_defaults)
     BOOST_CHECK_EQUAL( handler.getDt(), -1.f );
     BOOST_CHECK_EQUAL( handler.getDuration(), 10.0f );
     BOOST_CHECK_EQUAL( handler.getMaxBlockSize(), LB_64MB );
+    BOOST_CHECK( handler.getCacheDirectory().empty( ));
+    BOOST_CHECK( handler.getGeometryCache().empty( ));
+    BOOST_CHECK_EQUAL( handler.getCacheSize(), LB_1GB );
+    BOOST_CHECK_EQUAL( handler.getFrameCacheSize(), 0 );
+    BOOST_CHECK_EQUAL( handler.getPrefetchFrames(), 2 );
+    BOOST_CHECK( !handler.prefetchBricks( ));
 }
 
 BOOST_AUTO_TEST_CASE(compartment_full_circuit)
@@ -115,6 +121,8 @@ BOOST_AUTO_TEST_CASE(synapses)
     const fivox::URIHandler handler( fivox::URI( "fivoxsynapses://" ));
     BOOST_CHECK_EQUAL( handler.getType(), fivox::VolumeType::synapses );
     BOOST_CHECK_EQUAL( handler.getReport(), "voltages" );
+    BOOST_CHECK( handler.getSynapseCache().empty( ));
+    BOOST_CHECK_EQUAL( handler.getSynapseReads(), 1 );
 }
 
 BOOST_AUTO_TEST_CASE(vsd)
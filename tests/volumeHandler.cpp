@@ -95,6 +95,56 @@ BOOST_AUTO_TEST_CASE( VolumeHandlerRegion )
     BOOST_CHECK_EQUAL( region.GetSize(), expectedSize );
 }
 
+BOOST_AUTO_TEST_CASE( VolumeHandlerBrick )
+{
+    fivox::FloatVolume::RegionType region;
+    fivox::FloatVolume::IndexType expectedIndex;
+    fivox::FloatVolume::SizeType expectedSize;
+
+    fivox::VolumeHandler volumeHandler( 100, fivox::Vector3f( 50, 100, 42 ));
+
+    // largest factors go to the largest axes
+    BOOST_CHECK_EQUAL( volumeHandler.computeBrickLayout( 1 ),
+                       fivox::Vector3ui( 1, 1, 1 ));
+    BOOST_CHECK_EQUAL( volumeHandler.computeBrickLayout( 3 ),
+                       fivox::Vector3ui( 1, 3, 1 ));
+    BOOST_CHECK_EQUAL( volumeHandler.computeBrickLayout( 4 ),
+                       fivox::Vector3ui( 2, 2, 1 ));
+    BOOST_CHECK_EQUAL( volumeHandler.computeBrickLayout( 8 ),
+                       fivox::Vector3ui( 2, 2, 2 ));
+
+    // full volume brick
+    region = volumeHandler.computeBrick( fivox::Vector3ui( 0, 0, 0 ),
+                                         fivox::Vector3ui( 1, 1, 1 ));
+    expectedIndex[0] = 0; expectedIndex[1] = 0; expectedIndex[2] = 0;
+    expectedSize[0] = 50; expectedSize[1] = 100; expectedSize[2] = 42;
+    BOOST_CHECK_EQUAL( region.GetIndex(), expectedIndex );
+    BOOST_CHECK_EQUAL( region.GetSize(), expectedSize );
+
+    region = volumeHandler.computeBrick( fivox::Vector3ui( 1, 1, 0 ),
+                                         fivox::Vector3ui( 2, 2, 1 ));
+    expectedIndex[0] = 25; expectedIndex[1] = 50; expectedIndex[2] = 0;
+    expectedSize[0] = 25; expectedSize[1] = 50; expectedSize[2] = 42;
+    BOOST_CHECK_EQUAL( region.GetIndex(), expectedIndex );
+    BOOST_CHECK_EQUAL( region.GetSize(), expectedSize );
+
+    // odd number of voxels, bricks match the regions of computeRegion()
+    volumeHandler.setSize( 101 );
+    volumeHandler.setExtent( fivox::Vector3f( 100, 50, 42 ));
+
+    region = volumeHandler.computeBrick( fivox::Vector3ui( 2, 0, 0 ),
+                                         fivox::Vector3ui( 3, 1, 1 ));
+    BOOST_CHECK_EQUAL( region,
+                       volumeHandler.computeRegion( fivox::Vector2ui( 2, 3 )));
+
+    region = volumeHandler.computeBrick( fivox::Vector3ui( 0, 1, 1 ),
+                                         fivox::Vector3ui( 1, 3, 2 ));
+    expectedIndex[0] = 0; expectedIndex[1] = 16; expectedIndex[2] = 21;
+    expectedSize[0] = 101; expectedSize[1] = 17; expectedSize[2] = 21;
+    BOOST_CHECK_EQUAL( region.GetIndex(), expectedIndex );
+    BOOST_CHECK_EQUAL( region.GetSize(), expectedSize );
+}
+
 BOOST_AUTO_TEST_CASE( VolumeHandlerSpacing )
 {
     fivox::FloatVolume::SpacingType expectedSpacing;
@@ -0,0 +1,180 @@
+
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Eyescale Software GmbH nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE VolumeSeries
+
+#include "test.h"
+#include <fivox/volumeSeries.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+const fivox::Vector3ui size( 7, 5, 3 );
+const size_t numFrames = 4;
+
+float _getValue( const size_t x, const size_t y, const size_t z,
+                 const size_t frame )
+{
+    return x + 10 * y + 100 * z + 1000 * frame;
+}
+
+std::vector< float > _createFrame( const size_t frame )
+{
+    std::vector< float > volume;
+    for( size_t z = 0; z < size[2]; ++z )
+        for( size_t y = 0; y < size[1]; ++y )
+            for( size_t x = 0; x < size[0]; ++x )
+                volume.push_back( _getValue( x, y, z, frame ));
+    return volume;
+}
+}
+
+BOOST_AUTO_TEST_CASE( VolumeSeriesReadWrite )
+{
+    const std::string filename( "volumeSeries.fvs" );
+    {
+        fivox::VolumeSeriesWriter writer( filename, size, numFrames,
+                                          fivox::Vector3ui( 4, 2, 2 ),
+                                          fivox::VolumeDataType::float32 );
+        writer.setSpacing( fivox::Vector3f( 0.5f ));
+        writer.setOrigin( fivox::Vector3f( 1, 2, 3 ));
+
+        // frames can be written in any order, frame 2 is left empty
+        writer.writeFrame( 3, _createFrame( 3 ).data( ));
+        writer.writeFrame( 0, _createFrame( 0 ).data( ));
+        writer.writeFrame( 1, _createFrame( 1 ).data( ));
+        BOOST_CHECK_THROW( writer.writeFrame( numFrames,
+                                              _createFrame( 0 ).data( )),
+                           std::runtime_error );
+    }
+
+    const fivox::VolumeSeriesReader reader( filename );
+    BOOST_CHECK_EQUAL( reader.getSize(), size );
+    BOOST_CHECK_EQUAL( reader.getChunkSize(), fivox::Vector3ui( 4, 2, 2 ));
+    BOOST_CHECK_EQUAL( reader.getNumFrames(), numFrames );
+    BOOST_CHECK( reader.getDataType() == fivox::VolumeDataType::float32 );
+    BOOST_CHECK_EQUAL( reader.getSpacing(), fivox::Vector3f( 0.5f ));
+    BOOST_CHECK_EQUAL( reader.getOrigin(), fivox::Vector3f( 1, 2, 3 ));
+    BOOST_CHECK( reader.hasFrame( 0 ));
+    BOOST_CHECK( reader.hasFrame( 1 ));
+    BOOST_CHECK( !reader.hasFrame( 2 ));
+    BOOST_CHECK( reader.hasFrame( 3 ));
+    BOOST_CHECK( !reader.hasFrame( numFrames ));
+
+    std::vector< float > volume( size[0] * size[1] * size[2] );
+    reader.readFrame( 3, volume.data( ));
+    BOOST_CHECK( volume == _createFrame( 3 ));
+
+    // region crossing chunk boundaries over several frames
+    const fivox::Vector3ui begin( 1, 1, 1 );
+    const fivox::Vector3ui regionSize( 5, 3, 2 );
+    std::vector< float > region( regionSize[0] * regionSize[1] *
+                                 regionSize[2] * 2 );
+    reader.read( begin, regionSize, fivox::Vector2ui( 0, 2 ), region.data( ));
+
+    size_t i = 0;
+    for( size_t frame = 0; frame < 2; ++frame )
+        for( size_t z = 0; z < regionSize[2]; ++z )
+            for( size_t y = 0; y < regionSize[1]; ++y )
+                for( size_t x = 0; x < regionSize[0]; ++x )
+                    BOOST_CHECK_EQUAL( region[i++],
+                                       _getValue( x + begin[0], y + begin[1],
+                                                  z + begin[2], frame ));
+
+    BOOST_CHECK_THROW( reader.read( begin, size, fivox::Vector2ui( 0, 1 ),
+                                    region.data( )), std::runtime_error );
+    BOOST_CHECK_THROW( reader.readFrame( numFrames, volume.data( )),
+                       std::runtime_error );
+
+    ::remove( filename.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( VolumeSeriesInvalidFile )
+{
+    const std::string filename( "volumeSeriesInvalid.fvs" );
+    {
+        std::ofstream file( filename );
+        file << "not a volume series" << std::endl;
+    }
+    BOOST_CHECK_THROW( fivox::VolumeSeriesReader reader( filename ),
+                       std::runtime_error );
+    ::remove( filename.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( DeltaVolumeSeriesReadWrite )
+{
+    const std::string filename( "volumeSeries.fvd" );
+    const size_t numDeltaFrames = 7;
+    const size_t frameSize = size[0] * size[1] * size[2];
+
+    // sparse changes between frames, as in spike volumes
+    std::vector< std::vector< float >> frames( 1, _createFrame( 0 ));
+    for( size_t i = 1; i < numDeltaFrames; ++i )
+    {
+        frames.push_back( frames.back( ));
+        frames.back()[( i * 17 ) % frameSize ] += 0.5f;
+        frames.back()[( i * 31 ) % frameSize ] = -1.f;
+    }
+
+    {
+        fivox::DeltaVolumeSeriesWriter writer( filename, size, 3,
+                                               fivox::VolumeDataType::float32 );
+        writer.setOrigin( fivox::Vector3f( 1, 2, 3 ));
+        for( const auto& frame : frames )
+            writer.writeFrame( frame.data( ));
+    }
+
+    fivox::DeltaVolumeSeriesReader reader( filename );
+    BOOST_CHECK_EQUAL( reader.getSize(), size );
+    BOOST_CHECK_EQUAL( reader.getNumFrames(), numDeltaFrames );
+    BOOST_CHECK_EQUAL( reader.getKeyframeInterval(), size_t( 3 ));
+    BOOST_CHECK( reader.getDataType() == fivox::VolumeDataType::float32 );
+    BOOST_CHECK_EQUAL( reader.getOrigin(), fivox::Vector3f( 1, 2, 3 ));
+
+    // sequential, backward and random access
+    std::vector< float > volume( frameSize );
+    for( size_t i = 0; i < numDeltaFrames; ++i )
+    {
+        reader.readFrame( i, volume.data( ));
+        BOOST_CHECK( volume == frames[i] );
+    }
+    for( const size_t i : { 5, 4, 1, 6, 2 })
+    {
+        reader.readFrame( i, volume.data( ));
+        BOOST_CHECK( volume == frames[i] );
+    }
+    BOOST_CHECK_THROW( reader.readFrame( numDeltaFrames, volume.data( )),
+                       std::runtime_error );
+
+    ::remove( filename.c_str( ));
+}
@@ -0,0 +1,75 @@
+
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Eyescale Software GmbH nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE VolumeStatistics
+
+#include "test.h"
+#include <fivox/volumeStatistics.h>
+
+BOOST_AUTO_TEST_CASE( VolumeStatisticsRange )
+{
+    fivox::VolumeStatistics statistics;
+    BOOST_CHECK_EQUAL( statistics.getCount(), 0 );
+    BOOST_CHECK_EQUAL( statistics.getRange(), fivox::Vector2f( 0.f, 0.f ));
+
+    statistics.add( -3.5f );
+    statistics.add( 12.f );
+    statistics.add( std::numeric_limits< float >::quiet_NaN( ));
+    BOOST_CHECK_EQUAL( statistics.getCount(), 2 );
+    BOOST_CHECK_EQUAL( statistics.getRange(), fivox::Vector2f( -3.5f, 12.f ));
+    BOOST_CHECK( !statistics.hasHistogram( ));
+    BOOST_CHECK_EQUAL( statistics.getPercentile( 5.f ), -3.5f );
+    BOOST_CHECK_EQUAL( statistics.getPercentile( 95.f ), 12.f );
+}
+
+BOOST_AUTO_TEST_CASE( VolumeStatisticsPercentiles )
+{
+    // values from two threads, merged
+    fivox::VolumeStatistics first( true ), second( true );
+    for( size_t i = 0; i < 1000; ++i )
+        ( i % 2 ? first : second ).add( float( i ) - 500.f );
+
+    fivox::VolumeStatistics statistics( true );
+    statistics.merge( first );
+    statistics.merge( second );
+    BOOST_CHECK( statistics.hasHistogram( ));
+    BOOST_CHECK_EQUAL( statistics.getCount(), 1000 );
+    BOOST_CHECK_EQUAL( statistics.getRange(), fivox::Vector2f( -500.f, 499.f ));
+    BOOST_CHECK_EQUAL( statistics.getPercentile( 0.f ), -500.f );
+    BOOST_CHECK_EQUAL( statistics.getPercentile( 100.f ), 499.f );
+    BOOST_CHECK_CLOSE( statistics.getPercentile( 10.f ), -400.f, 1.f );
+    BOOST_CHECK_SMALL( statistics.getPercentile( 50.f ) + 1.f, 0.1f );
+    BOOST_CHECK_CLOSE( statistics.getPercentile( 90.f ), 400.f, 1.f );
+
+    // a histogram is incomplete after merging statistics without one
+    statistics.merge( fivox::VolumeStatistics( ));
+    BOOST_CHECK( !statistics.hasHistogram( ));
+}
@@ -0,0 +1,129 @@
+
+/* Copyright (c) 2016, EPFL/Blue Brain Project
+ *                     Stefan.Eilemann@epfl.ch
+ *
+ * This file is part of Fivox <https://github.com/BlueBrain/Fivox>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Eyescale Software GmbH nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+
+#define BOOST_TEST_MODULE VolumeWriter
+
+#include "test.h"
+#include <apps/volumeWriter.h>
+#include <fivox/genericLoader.h>
+#include <fivox/imageSource.h>
+#include <fivox/uriHandler.h>
+
+#include <itkImageFileReader.h>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+typedef fivox::ImageSourcePtr< fivox::FloatVolume > ImageSourcePtr;
+
+// the output geometry is set only once, as voxelize does
+ImageSourcePtr _newSource( const fivox::URIHandler& params )
+{
+    const fivox::EventSourcePtr loader =
+        std::make_shared< fivox::GenericLoader >( params );
+    const ImageSourcePtr source =
+        params.newImageSource< fivox::FloatVolume >( loader );
+
+    const fivox::FloatVolume::Pointer output = source->GetOutput();
+    _setSize< fivox::FloatVolume >( output, 8 );
+    fivox::FloatVolume::SpacingType spacing;
+    spacing.Fill( 2.f );
+    output->SetSpacing( spacing );
+    fivox::FloatVolume::PointType origin;
+    origin.Fill( -2.f );
+    output->SetOrigin( origin );
+    return source;
+}
+}
+
+BOOST_AUTO_TEST_CASE( VolumeWriterFrames )
+{
+    const fivox::URIHandler params( fivox::URI( "fivox://" ));
+    const uint32_t frames[] = { 0, 5 };
+    const std::string filenames[] = { "volumeWriter0.mhd",
+                                      "volumeWriter1.mhd" };
+    {
+        const ImageSourcePtr source = _newSource( params );
+        VolumeWriter< float > writer( source, params.getInputRange(),
+                                      params.getInputPercentiles( ));
+        for( size_t i = 0; i < 2; ++i )
+        {
+            source->getEventSource()->setFrame( frames[i] );
+            source->Modified();
+            writer.write( filenames[i] );
+        }
+        writer.flush();
+    }
+
+    // each written frame matches the one sampled by a separate pipeline
+    typedef itk::ImageFileReader< fivox::FloatVolume > Reader;
+    const ImageSourcePtr reference = _newSource( params );
+    std::vector< float > firstFrame;
+    for( size_t i = 0; i < 2; ++i )
+    {
+        reference->getEventSource()->setFrame( frames[i] );
+        reference->Modified();
+        reference->Update();
+        const fivox::FloatVolume::Pointer expected = reference->GetOutput();
+
+        Reader::Pointer reader = Reader::New();
+        reader->SetFileName( filenames[i] );
+        reader->Update();
+        const fivox::FloatVolume::Pointer volume = reader->GetOutput();
+
+        const size_t numVoxels =
+            expected->GetBufferedRegion().GetNumberOfPixels();
+        BOOST_CHECK_EQUAL( numVoxels, 8 * 8 * 8 );
+        BOOST_CHECK_EQUAL( volume->GetBufferedRegion().GetNumberOfPixels(),
+                           numVoxels );
+        for( size_t j = 0; j < 3; ++j )
+        {
+            BOOST_CHECK_EQUAL( volume->GetSpacing()[j], 2.f );
+            BOOST_CHECK_EQUAL( volume->GetOrigin()[j], -2.f );
+        }
+
+        const float* values = volume->GetBufferPointer();
+        const float* expectedValues = expected->GetBufferPointer();
+        BOOST_CHECK( std::equal( values, values + numVoxels,
+                                 expectedValues ));
+        if( i == 0 )
+            firstFrame.assign( values, values + numVoxels );
+        else
+            BOOST_CHECK( !std::equal( values, values + numVoxels,
+                                      firstFrame.begin( )));
+
+        ::remove( filenames[i].c_str( ));
+        const std::string raw = filenames[i].substr( 0,
+                                                     filenames[i].size() - 4 );
+        ::remove(( raw + ".raw" ).c_str( ));
+    }
+}